@@ -28,9 +28,9 @@ import Silk.CSS 3.0
 
 Css {
     id: css
-    property bool requestHeaderAvailable: typeof(http.requestHeader['user-agent']) === 'string'
-    property bool firefox: requestHeaderAvailable && http.requestHeader['user-agent'].indexOf('Firefox') > -1
-    property bool msie: requestHeaderAvailable && http.requestHeader['user-agent'].indexOf('Trident') > -1
+    property string userAgent: http.header('user-agent')
+    property bool firefox: userAgent.indexOf('Firefox') > -1
+    property bool msie: userAgent.indexOf('Trident') > -1
 
     Rule {
         id: root
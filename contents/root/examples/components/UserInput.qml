@@ -33,30 +33,23 @@ QtObject {
 
     Component.onCompleted: {
         var data = {};
-        if (http.query.length > 0) {
-            var arr = http.query.split(/&/);
-            for (var i = 0; i < arr.length; i++) {
-                var arr2 = arr[i].split(/=/);
-                var key = decodeURIComponent(arr2.shift().replace(/\+/g, ' '));
-                var val = decodeURIComponent(arr2.join('=').replace(/\+/g, ' '))
+        var assign = function(key, val) {
+            if (typeof root[key] !== 'undefined')
+                root[key] = val;
+            else
+                data[key] = val;
+        };
+        for (var key in http.params)
+            assign(key, http.param(key));
 
-                if (typeof root[key] !== 'undefined')
-                    root[key] = val;
-                else
-                    data[key] = val;
-            }
-        }
-        if (http.data.length > 0) {
+        // http.params reads only form encoded bodies, others are parsed as they used to be
+        if (http.header('content-type').indexOf('application/x-www-form-urlencoded') !== 0 && http.data.length > 0) {
             var arr = http.data.split(/&/);
             for (var i = 0; i < arr.length; i++) {
                 var arr2 = arr[i].split(/=/);
                 var key = decodeURIComponent(arr2.shift().replace(/\+/g, ' '));
                 var val = decodeURIComponent(arr2.join('=').replace(/\+/g, ' '))
-
-                if (typeof root[key] !== 'undefined')
-                    root[key] = val;
-                else
-                    data[key] = val;
+                assign(key, val);
             }
         }
         root.submit(data)
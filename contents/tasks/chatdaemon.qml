@@ -36,7 +36,7 @@ Server {
         switch (message.action) {
         case 'messages':
             if (sender !== null)
-                sender.respond({"action": "messages", "messages": root.messages});
+                sender.reply({"action": "messages", "messages": root.messages});
             break;
         case 'post': {
             var messages = root.messages;
@@ -17,7 +17,7 @@ isEmpty(SILKAPP_PRI) { SILKAPP_PRI = 1
         QT += qml
         LIBS += -L$$[QT_INSTALL_QML]/QtQml/Models.2/ -lmodelsplugin
 
-        LIBS += -L$$SILK_BUILD_TREE/$$SILK_TARGET_PATH/$$SILK_PLUGIN_PATH/mimehandler -ldeflate -lqml
+        LIBS += -L$$SILK_BUILD_TREE/$$SILK_TARGET_PATH/$$SILK_PLUGIN_PATH/mimehandler -lqml
 
         LIBS += -L$$SILK_BUILD_TREE/$$SILK_TARGET_PATH/$$SILK_PLUGIN_PATH/protocolhandler -lhttp
 
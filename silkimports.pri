@@ -8,6 +8,9 @@ isEmpty(SILKIMPORTS_PRI) { SILKIMPORTS_PRI = 1
     include(./silk.pri)
     include(./src/lib/lib.pri)
 
+    # the qml files in the resources are compiled at build time where qt has the compiler for it
+    equals(QT_MAJOR_VERSION, 5):greaterThan(QT_MINOR_VERSION, 10): CONFIG += qtquickcompiler
+
     contains(QT_CONFIG, reduce_exports): CONFIG += hide_symbols
 
     TARGET = $$qtLibraryTarget($$TARGET)
@@ -30,6 +30,54 @@
 #include <QtCore/QMetaProperty>
 #include <QtCore/QStringList>
 
+#include <silkoutputsink.h>
+#include <silkpropertytable.h>
+
+static void writeRule(SilkOutputSink &sink, const QString &selector, const QList<QPair<QByteArray, QString> > &attributes)
+{
+    sink.write(selector);
+    sink.write(" {\r\n    ");
+    for (int i = 0; i < attributes.count(); i++) {
+        if (i > 0)
+            sink.write("\r\n    ");
+        sink.write(attributes.at(i).first);
+        sink.write(": ");
+        sink.write(attributes.at(i).second);
+        sink.write(";");
+    }
+    sink.write("\r\n}\r\n");
+}
+
+// a string property rendered as a declaration
+struct Declaration
+{
+    int index;
+    QByteArray name;
+};
+
+// the declarations of a type are worked out from its property names
+static QVector<Declaration> declarationsOf(const QMetaObject *metaObject)
+{
+    QVector<Declaration> ret;
+    for (int i = 0; i < metaObject->propertyCount(); i++) {
+        QMetaProperty p = metaObject->property(i);
+        if (p.type() != QVariant::String) continue;
+
+        QString key(p.name());
+        if (key != key.toLower()) continue;
+        if (key.startsWith("__")) continue;
+        if (key == QStringLiteral("selector")) continue;
+        if (key.startsWith("_float")) key = key.mid(1);
+        key.replace('_', "-");
+
+        Declaration declaration;
+        declaration.index = i;
+        declaration.name = key.toUtf8();
+        ret.append(declaration);
+    }
+    return ret;
+}
+
 CssRule::CssRule(QObject *parent)
     : SilkAbstractHttpObject(parent)
     , m_selector()
@@ -38,52 +86,55 @@ CssRule::CssRule(QObject *parent)
 
 QString CssRule::out()
 {
-    QString ret;
-    QStringList list;
-    generate(list);
-    foreach (const QString &l, list) {
-        ret.append(l);
-    }
-    return ret;
+    SilkByteBuffer buffer;
+    out(buffer);
+    return buffer.toString();
 }
 
-void CssRule::generate(QStringList& list, const QStringList &selectors) const
+void CssRule::out(SilkOutputSink &sink)
 {
-    QStringList attributes = parseAttributes(this);
+    generate(sink);
+}
+
+void CssRule::generate(SilkOutputSink &sink, const QStringList &selectors) const
+{
+    QList<QPair<QByteArray, QString> > attributes;
+    parseAttributes(this, &attributes);
 
     foreach (const QObject *child, contentsList()) {
         const CssRule *css = qobject_cast<const CssRule *>(child);
         if (css && css->enabled() && css->selector().isEmpty()) {
-            attributes.append(parseAttributes(css));
+            parseAttributes(css, &attributes);
         }
     }
 
     QStringList newSelectors;
     if (selectors.isEmpty()) {
         if (m_selector.startsWith("@media ")) {
-            QStringList list2;
+            // the rules in a media query are indented
+            SilkByteBuffer buffer;
             foreach (const QObject *child, contentsList()) {
                 const CssRule *css = qobject_cast<const CssRule *>(child);
                 if (css && css->enabled() && !css->selector().isEmpty()) {
-                    css->generate(list2);
+                    css->generate(buffer);
                 }
             }
-            QString ret;
-            foreach (const QString &l, list2) {
-                ret.append(l);
-            }
+            QByteArray ret = buffer.data();
             ret.replace("\r\n", "\r\n    ");
-            list.append(QString("%1 {\r\n    %2\r\n}\r\n").arg(m_selector).arg(ret));
+            sink.write(m_selector);
+            sink.write(" {\r\n    ");
+            sink.write(ret);
+            sink.write("\r\n}\r\n");
         } else {
             if (!attributes.isEmpty()) {
-                list.append(QString("%1 {\r\n    %2\r\n}\r\n").arg(m_selector).arg(attributes.join("\r\n    ")));
+                writeRule(sink, m_selector, attributes);
             }
             if (!m_selector.isEmpty())
                 newSelectors.append(m_selector);
             foreach (const QObject *child, contentsList()) {
                 const CssRule *css = qobject_cast<const CssRule *>(child);
                 if (css && css->enabled()) {
-                    css->generate(list, newSelectors);
+                    css->generate(sink, newSelectors);
                 }
             }
         }
@@ -101,7 +152,7 @@ void CssRule::generate(QStringList& list, const QStringList &selectors) const
                     newSelector = s2;
                 }
                 if (!attributes.isEmpty()) {
-                    list.append(QString("%1 {\r\n    %2\r\n}\r\n").arg(newSelector).arg(attributes.join("\r\n    ")));
+                    writeRule(sink, newSelector, attributes);
                 }
             }
             newSelectors.append(newSelector);
@@ -110,48 +161,21 @@ void CssRule::generate(QStringList& list, const QStringList &selectors) const
         foreach (const QObject *child, contentsList()) {
             const CssRule *css = qobject_cast<const CssRule *>(child);
             if (css && css->enabled()) {
-                css->generate(list, newSelectors);
+                css->generate(sink, newSelectors);
             }
         }
     }
 }
 
-QStringList CssRule::parseAttributes(const CssRule *css) const
+void CssRule::parseAttributes(const CssRule *css, QList<QPair<QByteArray, QString> > *attributes) const
 {
-    QStringList ret;
-
-    int count = css->metaObject()->propertyCount();
-    for (int i = 0; i < count; i++) {
-        QMetaProperty p = css->metaObject()->property(i);
-        QString key(p.name());
-        if (key != key.toLower()) continue;
-        if (key.startsWith("__")) continue;
-        if (key.startsWith("_float")) key = key.mid(1);
-        key.replace('_', "-");
-
-        switch (p.type()) {
-        case QVariant::String: {
-            QString value = p.read(css).toString();
-
-            if (key == QStringLiteral("selector")) {
-            } else if (key == QStringLiteral("objectName")) {
-            } else if (!value.isEmpty()){
-                ret.append(QString("%1: %2;").arg(key).arg(value));
-            }
-            break; }
-        case QVariant::Bool: {
-//            bool value = p.read(this).toBool();
-            if (key == QStringLiteral("enabled")) {
-
-            } else {
-                // TODO support key="key" style
-            }
-            break; }
-        default:
-            break;
-        }
+    const QMetaObject *mo = css->metaObject();
+    const QVector<Declaration> &table = SilkPropertyTable<Declaration>::of(mo, declarationsOf);
+    for (int i = 0; i < table.count(); i++) {
+        const Declaration &declaration = table.at(i);
+        QString value = mo->property(declaration.index).read(css).toString();
+        if (!value.isEmpty())
+            attributes->append(qMakePair(declaration.name, value));
     }
-
-    return ret;
 }
 
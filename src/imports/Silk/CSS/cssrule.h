@@ -29,6 +29,7 @@
 
 #include <silkabstracthttpobject.h>
 
+#include <QtCore/QPair>
 #include <QtCore/QStringList>
 
 class CssRule : public SilkAbstractHttpObject
@@ -41,12 +42,13 @@ public:
     explicit CssRule(QObject *parent = 0);
     
     virtual QString out();
+    virtual void out(SilkOutputSink &sink);
 
 protected:
-    void generate(QStringList& list, const QStringList &selectors = QStringList()) const;
+    void generate(SilkOutputSink &sink, const QStringList &selectors = QStringList()) const;
 
 private:
-    QStringList parseAttributes(const CssRule *rule) const;
+    void parseAttributes(const CssRule *rule, QList<QPair<QByteArray, QString> > *attributes) const;
 
 signals:
     void selectorChanged(const QString &selector);
@@ -26,17 +26,68 @@
 
 #include "cacheobject.h"
 
+#include <QtCore/QDateTime>
 #include <QtCore/QDebug>
 
+#include <silkconfig.h>
+#include <silkoutputsink.h>
+
 QHash<QString, QVariant> CacheObject::cache;
+QCache<QString, CacheObject::Fragment> CacheObject::fragments;
+QMutex CacheObject::mutex;
 
 CacheObject::CacheObject(QObject *parent)
-    : QObject(parent)
+    : SilkAbstractHttpObject(parent)
+    , m_ttl(0)
 {
 }
 
+QString CacheObject::out()
+{
+    SilkByteBuffer buffer;
+    out(buffer);
+    return buffer.toString();
+}
+
+// the contents are rendered once per ttl seconds, or as long as they stay in the cache with no ttl
+void CacheObject::out(SilkOutputSink &sink)
+{
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    if (!m_key.isEmpty()) {
+        QMutexLocker locker(&mutex);
+        Fragment *fragment = fragments.object(m_key);
+        if (fragment && (fragment->expires == 0 || now < fragment->expires)) {
+            QByteArray data = fragment->data;
+            locker.unlock();
+            sink.write(data);
+            return;
+        }
+    }
+
+    SilkByteBuffer buffer;
+    foreach (QObject *child, contentsList()) {
+        SilkAbstractHttpObject *object = qobject_cast<SilkAbstractHttpObject *>(child);
+        if (object && object->enabled()) {
+            object->out(buffer);
+        }
+    }
+    sink.write(buffer.data());
+
+    if (!m_key.isEmpty()) {
+        Fragment *fragment = new Fragment;
+        fragment->data = buffer.data();
+        fragment->expires = m_ttl > 0 ? now + m_ttl * 1000 : 0;
+        static const int size = SilkConfig::value("cache.fragment", 4194304).toInt();
+        QMutexLocker locker(&mutex);
+        if (fragments.maxCost() != size)
+            fragments.setMaxCost(size);
+        fragments.insert(m_key, fragment, fragment->data.size());
+    }
+}
+
 QVariant CacheObject::fetch(const QString &key) const
 {
+    QMutexLocker locker(&mutex);
     if (cache.contains(key))
         return cache.value(key);
     return QVariant();
@@ -44,10 +95,12 @@ QVariant CacheObject::fetch(const QString &key) const
 
 void CacheObject::add(const QString &key, const QVariant &value)
 {
+    QMutexLocker locker(&mutex);
     cache.insert(key, value);
 }
 
 void CacheObject::remove(const QString &key)
 {
+    QMutexLocker locker(&mutex);
     cache.remove(key);
 }
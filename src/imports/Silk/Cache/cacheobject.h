@@ -27,23 +27,45 @@
 #ifndef CACHEOBJECT_H
 #define CACHEOBJECT_H
 
-#include <QtCore/QObject>
+#include <silkabstracthttpobject.h>
+
+#include <QtCore/QCache>
 #include <QtCore/QHash>
+#include <QtCore/QMutex>
 #include <QtCore/QVariant>
 
-class CacheObject : public QObject
+// keeps values across requests, and with a key the rendered output of its contents
+class CacheObject : public SilkAbstractHttpObject
 {
     Q_OBJECT
 
+    Q_PROPERTY(QString key READ key WRITE key NOTIFY keyChanged)
+    SILK_ADD_PROPERTY(const QString &, key, QString)
+    Q_PROPERTY(int ttl READ ttl WRITE ttl NOTIFY ttlChanged)
+    SILK_ADD_PROPERTY(int, ttl, int)
 public:
     explicit CacheObject(QObject *parent = 0);
 
+    virtual QString out();
+    virtual void out(SilkOutputSink &sink);
+
     Q_INVOKABLE QVariant fetch(const QString &key) const;
     Q_INVOKABLE void add(const QString &key, const QVariant &value);
     Q_INVOKABLE void remove(const QString &key);
 
+signals:
+    void keyChanged(const QString &key);
+    void ttlChanged(int ttl);
+
 private:
+    struct Fragment {
+        QByteArray data;
+        qint64 expires;
+    };
+
     static QHash<QString, QVariant> cache;
+    static QCache<QString, Fragment> fragments;
+    static QMutex mutex;
 };
 
 #endif // CACHEOBJECT_H
@@ -29,6 +29,8 @@
 #include <QtCore/QDebug>
 #include <QtCore/QJsonDocument>
 
+#include <silkoutputsink.h>
+
 JsonObject::JsonObject(QObject *parent)
     : SilkAbstractHttpObject(parent)
     , m_contentType("application/json; charset=utf-8")
@@ -38,5 +40,12 @@ JsonObject::JsonObject(QObject *parent)
 QString JsonObject::out()
 {
     QJsonDocument doc = QJsonDocument::fromVariant(m_object);
-    return QString(doc.toJson());
+    return QString::fromUtf8(doc.toJson());
+}
+
+// the document is UTF-8 already
+void JsonObject::out(SilkOutputSink &sink)
+{
+    QJsonDocument doc = QJsonDocument::fromVariant(m_object);
+    sink.write(doc.toJson());
 }
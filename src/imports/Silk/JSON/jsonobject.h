@@ -41,6 +41,7 @@ public:
     explicit JsonObject(QObject *parent = 0);
     
     virtual QString out();
+    virtual void out(SilkOutputSink &sink);
 
 signals:
     void contentTypeChanged(const QString &contentType);
@@ -28,20 +28,29 @@
 #include "server.h"
 
 #include <QtCore/QDebug>
+#include <QtCore/QPointer>
 
 Client::Client(QObject *parent)
     : SilkAbstractObject(parent)
     , server(0)
 {
+    qRegisterMetaType<QPointer<QObject> >();
 }
 
 void Client::request(const QVariantMap &message, QObject *sender)
 {
-    server->request(message, sender);
+    // the server may live in the main thread while the client lives in a worker
+    QMetaObject::invokeMethod(server, "receive", Q_ARG(QVariantMap, message), Q_ARG(QPointer<QObject>, QPointer<QObject>(sender)));
+}
+
+void Client::reply(const QVariantMap &message)
+{
+    // called from the server's thread, the handlers run in the client's
+    QMetaObject::invokeMethod(this, "respond", Qt::QueuedConnection, Q_ARG(QVariantMap, message));
 }
 
 void Client::componentComplete()
 {
     server = Server::server(m_connectionName);
-    connect(server, SIGNAL(respond(QVariantMap)), this, SIGNAL(respond(QVariantMap)));
+    connect(server, SIGNAL(respond(QVariantMap)), this, SIGNAL(respond(QVariantMap)), Qt::QueuedConnection);
 }
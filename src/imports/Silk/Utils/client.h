@@ -48,6 +48,7 @@ public:
 
 public slots:
     void request(const QVariantMap &message, QObject *sender = 0);
+    void reply(const QVariantMap &message);
 
 signals:
     void respond(const QVariantMap &message);
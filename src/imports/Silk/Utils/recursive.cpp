@@ -32,6 +32,8 @@
 #include <QtQml/QQmlEngine>
 #include <QtQml/QJSValue>
 
+#include <silkoutputsink.h>
+
 Recursive::Recursive(QObject *parent)
     : SilkAbstractHttpObject(parent)
     , m_target(nullptr)
@@ -40,8 +42,13 @@ Recursive::Recursive(QObject *parent)
 
 QString Recursive::out()
 {
-    QString ret;
+    SilkByteBuffer buffer;
+    out(buffer);
+    return buffer.toString();
+}
 
+void Recursive::out(SilkOutputSink &sink)
+{
 //    qDebug() << Q_FUNC_INFO << __LINE__ << m_target << m_child;
     QVariant child = m_child;
     static int qjsType = qRegisterMetaType<QJSValue>();
@@ -55,13 +62,10 @@ QString Recursive::out()
         SilkAbstractHttpObject *http = qobject_cast<SilkAbstractHttpObject *>(object);
         if (http) {
             http->setProperty("model", child);
-            ret.append(http->out());
+            http->out(sink);
         }
         object->deleteLater();
     } else {
         qDebug() << Q_FUNC_INFO << __LINE__ << child.type() << (int)child.type() << child;
     }
-
-//    qDebug() << Q_FUNC_INFO << __LINE__ << ret;
-    return ret;
 }
@@ -42,6 +42,7 @@ public:
     explicit Recursive(QObject *parent = 0);
 
     virtual QString out();
+    virtual void out(SilkOutputSink &sink);
 
 signals:
     void targetChanged(QQmlComponent *target);
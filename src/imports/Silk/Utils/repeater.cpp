@@ -33,6 +33,8 @@
 #include <QtQml/QQmlEngine>
 #include <QtQml/QJSValue>
 
+#include <silkoutputsink.h>
+
 Repeater::Repeater(QObject *parent)
     : SilkAbstractHttpObject(parent)
 {
@@ -40,7 +42,13 @@ Repeater::Repeater(QObject *parent)
 
 QString Repeater::out()
 {
-    QString ret;
+    SilkByteBuffer buffer;
+    out(buffer);
+    return buffer.toString();
+}
+
+void Repeater::out(SilkOutputSink &sink)
+{
     QVariantList list;
 
     QVariant model = m_model;
@@ -125,13 +133,12 @@ QString Repeater::out()
             QObject *obj = component->create(c);
             SilkAbstractHttpObject *http = qobject_cast<SilkAbstractHttpObject *>(obj);
             if (http && http->enabled()) {
-                ret.append(http->out());
+                http->out(sink);
             }
             obj->deleteLater();
             c->deleteLater();
         }
     }
-    return ret;
 }
 
 QQmlListProperty<QQmlComponent> Repeater::contents()
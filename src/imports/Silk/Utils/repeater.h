@@ -42,6 +42,7 @@ public:
     explicit Repeater(QObject *parent = 0);
     
     virtual QString out();
+    virtual void out(SilkOutputSink &sink);
 
     QQmlListProperty<QQmlComponent> contents();
 
@@ -25,10 +25,30 @@
  */
 
 #include "server.h"
+#include "client.h"
 
 #include <QtCore/QDebug>
 
+// stands for a client in the request handler, so that sender.respond() and
+// sender.reply() both run the client's handlers in the client's own thread
+class ClientProxy : public QObject
+{
+    Q_OBJECT
+public:
+    explicit ClientProxy(Client *client) : QObject(), m_client(client) {}
+
+public slots:
+    void respond(const QVariantMap &message) { reply(message); }
+    void reply(const QVariantMap &message) {
+        if (m_client) QMetaObject::invokeMethod(m_client.data(), "reply", Q_ARG(QVariantMap, message));
+    }
+
+private:
+    QPointer<Client> m_client;
+};
+
 QHash<QString, Server*> Server::serverMap;
+QMutex Server::mutex;
 
 Server::Server(QObject *parent)
     : SilkAbstractObject(parent)
@@ -37,10 +57,28 @@ Server::Server(QObject *parent)
 
 void Server::componentComplete()
 {
+    QMutexLocker locker(&mutex);
     serverMap.insert(m_connectionName, this);
 }
 
+void Server::receive(const QVariantMap &message, const QPointer<QObject> &sender)
+{
+    // the client may have gone while the request was queued
+    Client *client = qobject_cast<Client *>(sender.data());
+    if (!client) {
+        emit request(message, sender.data());
+        return;
+    }
+
+    ClientProxy *proxy = new ClientProxy(client);
+    emit request(message, proxy);
+    proxy->deleteLater();
+}
+
 Server *Server::server(const QString &connectionName)
 {
+    QMutexLocker locker(&mutex);
     return Server::serverMap.value(connectionName);
 }
+
+#include "server.moc"
@@ -29,6 +29,9 @@
 
 #include <silkabstractobject.h>
 
+#include <QtCore/QMutex>
+#include <QtCore/QPointer>
+
 #include <QtQml/QQmlParserStatus>
 
 class Server : public SilkAbstractObject, public QQmlParserStatus
@@ -46,6 +49,9 @@ public:
     virtual void classBegin() {}
     virtual void componentComplete();
 
+public slots:
+    void receive(const QVariantMap &message, const QPointer<QObject> &sender);
+
 signals:
     void request(const QVariantMap &message, QObject *sender);
     void respond(const QVariantMap &message);
@@ -54,6 +60,7 @@ signals:
 
 private:
     static QHash<QString, Server*> serverMap;
+    static QMutex mutex;
 };
 
 #endif // SERVER_H
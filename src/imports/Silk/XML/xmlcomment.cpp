@@ -26,6 +26,8 @@
 
 #include "xmlcomment.h"
 
+#include <silkoutputsink.h>
+
 XmlComment::XmlComment(QObject *parent)
     : SilkAbstractHttpObject(parent)
 {
@@ -33,17 +35,23 @@ XmlComment::XmlComment(QObject *parent)
 
 QString XmlComment::out()
 {
-    QString ret(QStringLiteral("<!--"));
+    SilkByteBuffer buffer;
+    out(buffer);
+    return buffer.toString();
+}
+
+void XmlComment::out(SilkOutputSink &sink)
+{
+    sink.write("<!--");
     if (m_text.isNull()) {
         foreach (QObject *child, contentsList()) {
             SilkAbstractHttpObject *object = qobject_cast<SilkAbstractHttpObject *>(child);
             if (object && object->enabled()) {
-                ret.append(object->out());
+                object->out(sink);
             }
         }
     } else {
-        ret.append(m_text);
+        sink.write(m_text);
     }
-    ret.append(QStringLiteral("-->"));
-    return ret;
+    sink.write("-->");
 }
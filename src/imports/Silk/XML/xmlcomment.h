@@ -39,6 +39,7 @@ public:
     explicit XmlComment(QObject *parent = 0);
     
     virtual QString out();
+    virtual void out(SilkOutputSink &sink);
 
 signals:
     void textChanged(const QString &text);
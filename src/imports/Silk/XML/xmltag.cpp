@@ -29,25 +29,25 @@
 #include <QtCore/QDebug>
 #include <QtCore/QMetaProperty>
 
-XmlTag::XmlTag(QObject *parent)
-    : SilkAbstractHttpObject(parent)
-    , m_contentType(QStringLiteral("application/xml; charset=utf-8"))
-    , m_prolog(QStringLiteral("<?xml version=\"1.0\" encoding=\"UTF-8\" ?>"))
-    , m_nonVoid(false)
-{
-}
+#include <silkoutputsink.h>
+#include <silkpropertytable.h>
 
-QString XmlTag::out()
+// a string property rendered as an attribute, or the text of a tag
+struct Attribute
 {
-    QString ret;
+    int index;
+    QByteArray name;
+    bool text;
+};
 
-    bool tagNameIsEmpty = tagName().isEmpty();
-    QString text;
-    QString attributes;
+// the attributes of a type are worked out from its property names
+static QVector<Attribute> attributesOf(const QMetaObject *metaObject)
+{
+    QVector<Attribute> ret;
+    for (int i = 0; i < metaObject->propertyCount(); i++) {
+        const QMetaProperty &p = metaObject->property(i);
+        if (p.type() != QVariant::String) continue;
 
-    int count = metaObject()->propertyCount();
-    for (int i = 0; i < count; i++) {
-        const QMetaProperty &p = metaObject()->property(i);
         QString key(p.name());
         if (key == QStringLiteral("prolog")) continue;
 
@@ -66,32 +66,69 @@ QString XmlTag::out()
         key.replace(QStringLiteral("__"), QStringLiteral(":"));
         key.replace(QLatin1Char('_'), QLatin1Char('-'));
 
-        switch (p.type()) {
-        case QVariant::String: {
-            QString value = p.read(this).toString();
-            if (key == QStringLiteral("text")) {
-                text = value;
-            } else if (!value.isNull()){
-                if (!value.isEmpty()) {
-                    attributes.append(QString(" %1=\"%2\"").arg(key).arg(value));
-                }
-            }
-            break; }
-        case QVariant::Bool: {
-//            bool value = p.read(this).toBool();
-//            if (key == QStringLiteral("enabled")) {
-
-//            } else {
-//                // TODO support key="key" style
-//            }
-            break; }
-        default:
-            break;
-        }
+        Attribute attribute;
+        attribute.index = i;
+        attribute.name = key.toUtf8();
+        attribute.text = (key == QStringLiteral("text"));
+        ret.append(attribute);
+    }
+    return ret;
+}
+
+XmlTag::XmlTag(QObject *parent)
+    : SilkAbstractHttpObject(parent)
+    , m_contentType(QStringLiteral("application/xml; charset=utf-8"))
+    , m_prolog(QStringLiteral("<?xml version=\"1.0\" encoding=\"UTF-8\" ?>"))
+    , m_nonVoid(false)
+{
+}
+
+QString XmlTag::out()
+{
+    SilkByteBuffer buffer;
+    out(buffer);
+    return buffer.toString();
+}
+
+void XmlTag::out(SilkOutputSink &sink)
+{
+    QVariant escapeHTML = property("escapeHTML");
+    if (escapeHTML.isValid() && escapeHTML.toBool()) {
+        // an escaped tag inside of an escaped tag adds a level to the outer escaping
+        SilkEscapeSink *outer = dynamic_cast<SilkEscapeSink *>(&sink);
+        SilkEscapeSink escape(outer ? outer->sink() : sink
+                              , outer ? outer->mode() : SilkEscapeSink::Text
+                              , outer ? outer->depth() + 1 : 1);
+        write(escape);
+    } else {
+        write(sink);
     }
+}
 
+void XmlTag::write(SilkOutputSink &ret)
+{
+    QByteArray tag = tagName().toUtf8();
+    bool tagNameIsEmpty = tag.isEmpty();
     if (!tagNameIsEmpty) {
-        ret.append(QString("<%1%2").arg(tagName()).arg(attributes));
+        ret.write("<");
+        ret.write(tag);
+    }
+
+    QString text;
+    const QMetaObject *mo = metaObject();
+    const QVector<Attribute> &table = SilkPropertyTable<Attribute>::of(mo, attributesOf);
+    for (int i = 0; i < table.count(); i++) {
+        const Attribute &attribute = table.at(i);
+        QString value = mo->property(attribute.index).read(this).toString();
+        if (attribute.text) {
+            text = value;
+        } else if (!value.isEmpty() && !tagNameIsEmpty) {
+            ret.write(" ");
+            ret.write(attribute.name);
+            ret.write("=\"");
+            ret.write(SilkEscapeSink::escape(value, SilkEscapeSink::Attribute));
+            ret.write("\"");
+        }
     }
 
     bool hasChildObjects = false;
@@ -99,8 +136,8 @@ QString XmlTag::out()
     if (!text.isEmpty() || m_nonVoid) {
         hasChildObjects = true;
         if (!tagNameIsEmpty)
-            ret.append(QLatin1Char('>'));
-        ret.append(text);
+            ret.write(">");
+        ret.write(text);
     }
 
     foreach (QObject *child, contentsList()) {
@@ -108,29 +145,25 @@ QString XmlTag::out()
         if (object && object->enabled()) {
             if (!hasChildObjects) {
                 if (!tagNameIsEmpty)
-                    ret.append(QLatin1Char('>'));
+                    ret.write(">");
                 hasChildObjects = true;
             }
-            ret.append(object->out());
+            object->out(ret);
         }
     }
 
     if (!tagNameIsEmpty) {
         if (hasChildObjects) {
-            ret.append(QString("</%1>").arg(tagName()));
+            ret.write("</");
+            ret.write(tag);
+            ret.write(">");
         } else if (!text.isEmpty() || m_nonVoid){
-            ret.append(QString("></%1>").arg(tagName()));
+            ret.write("></");
+            ret.write(tag);
+            ret.write(">");
         } else {
-            ret.append(QStringLiteral(" />"));
+            ret.write(" />");
         }
     }
-
-    QVariant escapeHTML = property("escapeHTML");
-    if (escapeHTML.isValid() && escapeHTML.toBool()) {
-        ret.replace(QStringLiteral("&"), QStringLiteral("&amp;"));
-        ret.replace(QStringLiteral("<"), QStringLiteral("&lt;"));
-        ret.replace(QStringLiteral(">"), QStringLiteral("&gt;"));
-    }
-    return ret;
 }
 
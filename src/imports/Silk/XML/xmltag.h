@@ -42,6 +42,7 @@ public:
     explicit XmlTag(QObject *parent = 0);
     
     virtual QString out();
+    virtual void out(SilkOutputSink &sink);
 
 signals:
     void prologChanged(const QString &prolog);
@@ -51,6 +52,8 @@ signals:
     void nonVoidChanged(bool nonVoid);
 
 private:
+    void write(SilkOutputSink &ret);
+
     Q_DISABLE_COPY(XmlTag)
     SILK_ADD_PROPERTY(const QString &, contentType, QString)
     SILK_ADD_PROPERTY(const QString &, prolog, QString)
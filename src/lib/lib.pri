@@ -7,3 +7,6 @@ include(../../qthttpserver/include.pri)
 LIBS *= -L$$SILK_BUILD_TREE/$$SILK_TARGET_PATH/$$SILK_LIBRARY_PATH
 
 LIBS *= -l$$qtLibraryName(silk)
+
+# a static libsilk leaves zlib to be linked by the application
+CONFIG(static, static|shared): unix: LIBS *= -lz
@@ -8,6 +8,10 @@ include(../../qthttpserver/qthttpserver.pri)
 
 DEFINES += SILK_LIBRARY
 
+# compression of responses
+unix: LIBS += -lz
+else: INCLUDEPATH += $$[QT_INSTALL_HEADERS]/QtZlib
+
 HEADERS += \
     silkglobal.h \
     silkconfig.h \
@@ -18,6 +22,10 @@ HEADERS += \
     silkprotocolhandlerinterface.h \
     silkabstractprotocolhandler.h \
     silkabstractobject.h \
+    silkcompressor.h \
+    silkhttp.h \
+    silkoutputsink.h \
+    silkpropertytable.h \
     silkserver.h
 
 SOURCES += \
@@ -26,4 +34,7 @@ SOURCES += \
     silkabstractmimehandler.cpp \
     silkabstractprotocolhandler.cpp \
     silkabstractobject.cpp \
+    silkcompressor.cpp \
+    silkhttp.cpp \
+    silkoutputsink.cpp \
     silkserver.cpp
@@ -25,9 +25,15 @@
  */
 
 #include "silkabstracthttpobject.h"
+#include "silkoutputsink.h"
 
 SilkAbstractHttpObject::SilkAbstractHttpObject(QObject *parent)
     : SilkAbstractObject(parent)
     , m_enabled(true)
 {
 }
+
+void SilkAbstractHttpObject::out(SilkOutputSink &sink)
+{
+    sink.write(out());
+}
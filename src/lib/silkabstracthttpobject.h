@@ -31,6 +31,7 @@
 #include "silkabstractobject.h"
 
 class QQmlContext;
+class SilkOutputSink;
 
 class SILK_EXPORT SilkAbstractHttpObject : public SilkAbstractObject
 {
@@ -42,6 +43,8 @@ public:
     explicit SilkAbstractHttpObject(QObject *parent = 0);
 
     virtual QString out() = 0;
+    // renders into sink fragment by fragment, the whole out() by default
+    virtual void out(SilkOutputSink &sink);
 
 signals:
     void enabledChanged(bool enabled);
@@ -44,6 +44,8 @@ public:
     
     virtual bool load(const QUrl &url, QHttpRequest *request, QHttpReply *reply, const QString &message = QString()) = 0;
     virtual bool load(const QUrl &url, QWebSocket *socket, const QString &message = QString()) { Q_UNUSED(url) Q_UNUSED(socket) Q_UNUSED(message) return false; }
+    // prepares the documents of a document root before the server starts listening
+    virtual void warmUp(const QString &documentRoot) { Q_UNUSED(documentRoot) }
 
 signals:
     void error(int code, QHttpRequest *request, QHttpReply *reply, const QString &errorString = QString());
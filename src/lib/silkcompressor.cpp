@@ -0,0 +1,199 @@
+/* Copyright (c) 2012 Silk Project.
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Silk nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL SILK BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "silkcompressor.h"
+#include "silkconfig.h"
+
+#include <QtCore/QDebug>
+#include <QtCore/QStringList>
+
+#include <zlib.h>
+
+class SilkCompressor::Private
+{
+public:
+    Private(Encoding encoding);
+    ~Private();
+
+    QByteArray deflate(const char *data, qint64 size, int flush);
+
+    Encoding encoding;
+    bool initialized;
+    z_stream stream;
+};
+
+SilkCompressor::Private::Private(Encoding encoding)
+    : encoding(encoding)
+    , initialized(false)
+    , stream()
+{
+    if (encoding == Identity) return;
+    if (encoding == Brotli) {
+        qWarning() << "brotli is supported only for precompressed files.";
+        return;
+    }
+
+    int level = SilkConfig::value("deflate.level", Z_DEFAULT_COMPRESSION).toInt();
+    // 15 is a zlib stream as "deflate" means, +16 wraps it as gzip
+    int ret = deflateInit2(&stream, level, Z_DEFLATED
+                           , encoding == Gzip ? 15 + 16 : 15, 8, Z_DEFAULT_STRATEGY);
+    if (ret == Z_OK) {
+        initialized = true;
+    } else {
+        qWarning() << "deflateInit2 failed:" << ret;
+    }
+}
+
+SilkCompressor::Private::~Private()
+{
+    if (initialized)
+        deflateEnd(&stream);
+}
+
+QByteArray SilkCompressor::Private::deflate(const char *data, qint64 size, int flush)
+{
+    QByteArray ret;
+    if (!initialized) return ret;
+
+    stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data));
+    stream.avail_in = size;
+    ret.resize(deflateBound(&stream, size) + 16);
+    int length = 0;
+    forever {
+        if (length == ret.size())
+            ret.resize(ret.size() * 2);
+        stream.next_out = reinterpret_cast<Bytef *>(ret.data() + length);
+        stream.avail_out = ret.size() - length;
+        int status = ::deflate(&stream, flush);
+        length = ret.size() - stream.avail_out;
+        if (status == Z_STREAM_END) break;
+        if (status != Z_OK && status != Z_BUF_ERROR) {
+            qWarning() << "deflate failed:" << status;
+            break;
+        }
+        // all the input is consumed and flushed when the output buffer is not filled up
+        if (stream.avail_in == 0 && stream.avail_out > 0) break;
+    }
+    ret.resize(length);
+    return ret;
+}
+
+SilkCompressor::SilkCompressor(Encoding encoding)
+    : d(new Private(encoding))
+{
+}
+
+SilkCompressor::~SilkCompressor()
+{
+    delete d;
+}
+
+SilkCompressor::Encoding SilkCompressor::encoding() const
+{
+    return d->encoding;
+}
+
+QByteArray SilkCompressor::compress(const char *data, qint64 size)
+{
+    if (d->encoding == Identity) return QByteArray(data, size);
+    return d->deflate(data, size, Z_SYNC_FLUSH);
+}
+
+QByteArray SilkCompressor::finish()
+{
+    if (d->encoding == Identity) return QByteArray();
+    return d->deflate(0, 0, Z_FINISH);
+}
+
+QByteArray SilkCompressor::compress(const QByteArray &data, Encoding encoding)
+{
+    if (encoding == Identity) return data;
+    SilkCompressor compressor(encoding);
+    return compressor.d->deflate(data.constData(), data.size(), Z_FINISH);
+}
+
+bool SilkCompressor::isCompressible(const QByteArray &contentType)
+{
+    static const QStringList excludes = SilkConfig::value("deflate.excludes", QStringList() << QStringLiteral("video/*") << QStringLiteral("image/*")).toStringList();
+
+    QString mime = QString::fromLatin1(contentType).section(QLatin1Char(';'), 0, 0).trimmed().toLower();
+    if (mime.isEmpty()) return false;
+    foreach (const QString &exclude, excludes) {
+        if (exclude.endsWith(QStringLiteral("/*"))) {
+            if (mime.startsWith(exclude.left(exclude.length() - 1))) return false;
+        } else if (mime == exclude) {
+            return false;
+        }
+    }
+    return true;
+}
+
+SilkCompressor::Encoding SilkCompressor::negotiate(const QByteArray &acceptEncoding, const QByteArray &contentType)
+{
+    if (acceptEncoding.isEmpty() || !isCompressible(contentType)) return Identity;
+
+    // gzip wins a tie, some old clients expect raw deflate for "deflate"
+    qreal gzip = quality(acceptEncoding, Gzip);
+    qreal deflate = quality(acceptEncoding, Deflate);
+    if (gzip > 0 && gzip >= deflate) return Gzip;
+    if (deflate > 0) return Deflate;
+    return Identity;
+}
+
+qreal SilkCompressor::quality(const QByteArray &acceptEncoding, Encoding encoding)
+{
+    QByteArray coding = name(encoding);
+    foreach (const QByteArray &item, acceptEncoding.split(',')) {
+        QList<QByteArray> params = item.split(';');
+        QByteArray value = params.takeFirst().trimmed().toLower();
+        if (value != coding && !(encoding == Gzip && value == "x-gzip")) continue;
+
+        qreal ret = 1.0;
+        foreach (const QByteArray &param, params) {
+            QByteArray p = param.trimmed();
+            if (p.startsWith("q=")) {
+                ret = p.mid(2).toDouble();
+            }
+        }
+        return ret;
+    }
+    return 0.0;
+}
+
+QByteArray SilkCompressor::name(Encoding encoding)
+{
+    switch (encoding) {
+    case Deflate:
+        return QByteArrayLiteral("deflate");
+    case Gzip:
+        return QByteArrayLiteral("gzip");
+    case Brotli:
+        return QByteArrayLiteral("br");
+    default:
+        break;
+    }
+    return QByteArrayLiteral("identity");
+}
@@ -1,6 +1,6 @@
 /* Copyright (c) 2012 Silk Project.
  * All rights reserved.
- *
+ * 
  * Redistribution and use in source and binary forms, with or without
  * modification, are permitted provided that the following conditions are met:
  *     * Redistributions of source code must retain the above copyright
@@ -11,7 +11,7 @@
  *     * Neither the name of the Silk nor the
  *       names of its contributors may be used to endorse or promote products
  *       derived from this software without specific prior written permission.
- *
+ * 
  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
  * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
  * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
@@ -24,33 +24,44 @@
  * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
-#ifndef DEFLATEPLUGIN_H
-#define DEFLATEPLUGIN_H
+#ifndef SILKCOMPRESSOR_H
+#define SILKCOMPRESSOR_H
 
-#include <QtCore/QDebug>
-#include <QtCore/QObject>
-#include <QtCore/QStringList>
-#include <silkmimehandlerinterface.h>
-#include <silkconfig.h>
-#include "deflatehandler.h"
+#include "silkglobal.h"
 
-class DeflatePlugin : public QObject, SilkMimeHandlerInterface
+#include <QtCore/QByteArray>
+
+class SILK_EXPORT SilkCompressor
 {
-    Q_OBJECT
-    Q_PLUGIN_METADATA(IID "me.qtquick.silk.plugins.mime")
-    Q_INTERFACES(SilkMimeHandlerInterface)
 public:
-    virtual QStringList keys() const {
-        QStringList ret;
-        foreach (const QVariant &value, SilkConfig::value("deflate.excludes").toList()) {
-            ret.append(value.toString());
-        }
-        return ret;
-    }
-
-    virtual SilkAbstractMimeHandler *handler(QObject *parent) {
-        return new DeflateHandler(parent);
-    }
+    enum Encoding {
+        Identity,
+        Deflate,
+        Gzip,
+        Brotli // served only from precompressed files
+    };
+
+    explicit SilkCompressor(Encoding encoding);
+    ~SilkCompressor();
+
+    Encoding encoding() const;
+
+    // compressed data is flushed at the end of each call, so that it can be sent right away
+    QByteArray compress(const char *data, qint64 size);
+    QByteArray compress(const QByteArray &data) { return compress(data.constData(), data.size()); }
+    QByteArray finish();
+
+    static QByteArray compress(const QByteArray &data, Encoding encoding);
+
+    static bool isCompressible(const QByteArray &contentType);
+    static Encoding negotiate(const QByteArray &acceptEncoding, const QByteArray &contentType);
+    static qreal quality(const QByteArray &acceptEncoding, Encoding encoding);
+    static QByteArray name(Encoding encoding);
+
+private:
+    Q_DISABLE_COPY(SilkCompressor)
+    class Private;
+    Private *d;
 };
 
-#endif // DEFLATEPLUGIN_H
+#endif // SILKCOMPRESSOR_H
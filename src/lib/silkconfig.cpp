@@ -33,6 +33,13 @@ QVariant SilkConfig::value(const QString &key)
     return m_config.value(key);
 }
 
+// a user config replaces whole sections, so a key it leaves out of a section has no value
+QVariant SilkConfig::value(const QString &key, const QVariant &defaultValue)
+{
+    QVariant ret = value(key);
+    return ret.isValid() ? ret : defaultValue;
+}
+
 void SilkConfig::initialize(int argc, char **argv)
 {
     m_config = readConfigFile(QString(":/%1rc").arg(QCoreApplication::instance()->applicationName().toLower()));
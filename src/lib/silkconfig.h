@@ -11,6 +11,7 @@ public:
     static void initialize(int argc, char **argv);
     static const QVariantMap &config();
     static QVariant value(const QString &key);
+    static QVariant value(const QString &key, const QVariant &defaultValue);
     static const QString &file();
 
 private:
@@ -24,22 +24,30 @@
  * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
-#include "deflatehandler.h"
+#include "silkhttp.h"
 
-#include <QtCore/QDebug>
+#include <qhttprequest.h>
 
-#include <qhttpreply.h>
-
-DeflateHandler::DeflateHandler(QObject *parent)
-    : SilkAbstractMimeHandler(parent)
+// header names are case insensitive, and the request keeps them as the client sent them
+QByteArray SilkHttp::header(QHttpRequest *request, const QByteArray &name)
 {
+    QByteArray ret = request->rawHeader(name);
+    if (!ret.isNull()) return ret;
+    foreach (const QByteArray &key, request->rawHeaderList()) {
+        if (qstricmp(key.constData(), name.constData()) == 0)
+            return request->rawHeader(key);
+    }
+    return QByteArray();
 }
 
-bool DeflateHandler::load(const QUrl &url, QHttpRequest *request, QHttpReply *reply, const QString &message)
+// weak comparison as If-None-Match requires
+bool SilkHttp::matchETag(const QByteArray &value, const QByteArray &etag)
 {
-    Q_UNUSED(url)
-    Q_UNUSED(request)
-    Q_UNUSED(message)
-    reply->setRawHeader("Content-Encoding", "none");
+    foreach (QByteArray tag, value.split(',')) {
+        tag = tag.trimmed();
+        if (tag == "*") return true;
+        if (tag.startsWith("W/")) tag = tag.mid(2);
+        if (tag == etag) return true;
+    }
     return false;
 }
@@ -24,19 +24,24 @@
  * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
-#ifndef DEFLATEHANDLER_H
-#define DEFLATEHANDLER_H
+#ifndef SILKHTTP_H
+#define SILKHTTP_H
 
-#include <silkabstractmimehandler.h>
+#include "silkglobal.h"
 
-class DeflateHandler : public SilkAbstractMimeHandler
-{
-    Q_OBJECT
+#include <QtCore/QByteArray>
+
+class QHttpRequest;
 
+// helpers shared by the handlers of http requests
+class SILK_EXPORT SilkHttp
+{
 public:
-    explicit DeflateHandler(QObject *parent = 0);
-    
-    virtual bool load(const QUrl &url, QHttpRequest *request, QHttpReply *reply, const QString &message = QString());
+    static QByteArray header(QHttpRequest *request, const QByteArray &name);
+    static bool matchETag(const QByteArray &value, const QByteArray &etag);
+
+private:
+    SilkHttp() {}
 };
 
-#endif // DEFLATEHANDLER_H
+#endif // SILKHTTP_H
@@ -0,0 +1,127 @@
+/* Copyright (c) 2012 Silk Project.
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Silk nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL SILK BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "silkoutputsink.h"
+
+SilkOutputSink::~SilkOutputSink()
+{
+}
+
+void SilkOutputSink::write(const QString &data)
+{
+    QByteArray utf8 = data.toUtf8();
+    writeData(utf8.constData(), utf8.size());
+}
+
+SilkByteBuffer::SilkByteBuffer(int capacity)
+{
+    if (capacity > 0)
+        m_data.reserve(capacity);
+}
+
+void SilkByteBuffer::writeData(const char *data, int size)
+{
+    m_data.append(data, size);
+}
+
+// the entity of a character without the leading &, or 0 when it is written as it is
+static inline const char *entity(ushort c, SilkEscapeSink::Mode mode)
+{
+    if (c > '>') return 0;
+    switch (c) {
+    case '&':
+        return "amp;";
+    case '<':
+        return "lt;";
+    case '>':
+        return "gt;";
+    case '"':
+        return mode == SilkEscapeSink::Attribute ? "quot;" : 0;
+    case '\'':
+        return mode == SilkEscapeSink::Attribute ? "#39;" : 0;
+    default:
+        break;
+    }
+    return 0;
+}
+
+SilkEscapeSink::SilkEscapeSink(SilkOutputSink &sink, Mode mode, int depth)
+    : m_sink(sink)
+    , m_mode(mode)
+    , m_depth(qMax(1, depth))
+{
+    // "&lt;" escaped once more is "&amp;lt;". a single level needs no prefix of its own
+    if (m_depth > 1) {
+        m_prefix = "&";
+        for (int i = 1; i < m_depth; i++)
+            m_prefix.append("amp;");
+    }
+}
+
+// the characters to escape are ASCII, so they never appear inside of a UTF-8 sequence
+void SilkEscapeSink::writeData(const char *data, int size)
+{
+    int start = 0;
+    for (int i = 0; i < size; i++) {
+        const char *name = entity(static_cast<uchar>(data[i]), m_mode);
+        if (!name) continue;
+        m_sink.write(data + start, i - start);
+        if (m_prefix.isEmpty())
+            m_sink.write("&");
+        else
+            m_sink.write(m_prefix);
+        m_sink.write(name, qstrlen(name));
+        start = i + 1;
+    }
+    m_sink.write(data + start, size - start);
+}
+
+QString SilkEscapeSink::escape(const QString &source, Mode mode)
+{
+    const QChar *data = source.constData();
+    int size = source.size();
+
+    // most strings have nothing to escape and are returned without a copy
+    int i = 0;
+    while (i < size && !entity(data[i].unicode(), mode))
+        i++;
+    if (i == size)
+        return source;
+
+    QString ret;
+    ret.reserve(size + size / 8 + 8);
+    int start = 0;
+    for (; i < size; i++) {
+        const char *name = entity(data[i].unicode(), mode);
+        if (!name) continue;
+        ret.append(data + start, i - start);
+        ret.append(QLatin1Char('&'));
+        ret.append(QLatin1String(name));
+        start = i + 1;
+    }
+    ret.append(data + start, size - start);
+    return ret;
+}
@@ -0,0 +1,101 @@
+/* Copyright (c) 2012 Silk Project.
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Silk nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL SILK BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef SILKOUTPUTSINK_H
+#define SILKOUTPUTSINK_H
+
+#include "silkglobal.h"
+
+#include <QtCore/QByteArray>
+#include <QtCore/QString>
+
+// receives the output as UTF-8, so that it goes to the reply without being transcoded again
+class SILK_EXPORT SilkOutputSink
+{
+public:
+    virtual ~SilkOutputSink();
+
+    void write(const char *data, int size) { writeData(data, size); }
+    void write(const QByteArray &data) { writeData(data.constData(), data.size()); }
+    void write(const QString &data);
+    // literals are written as they are, so they have to be ASCII
+    template<int N>
+    void write(const char (&literal)[N]) { writeData(literal, N - 1); }
+
+protected:
+    virtual void writeData(const char *data, int size) = 0;
+};
+
+// builds the output in memory, for out() of the objects which render into a sink
+class SILK_EXPORT SilkByteBuffer : public SilkOutputSink
+{
+public:
+    explicit SilkByteBuffer(int capacity = 0);
+
+    void reserve(int capacity) { m_data.reserve(capacity); }
+    void clear() { m_data.clear(); }
+    int size() const { return m_data.size(); }
+    bool isEmpty() const { return m_data.isEmpty(); }
+    const QByteArray &data() const { return m_data; }
+    QString toString() const { return QString::fromUtf8(m_data); }
+
+protected:
+    virtual void writeData(const char *data, int size);
+
+private:
+    QByteArray m_data;
+};
+
+// escapes the output for html in a single pass. text escapes & < and >, attribute also the quotes.
+// the output of an escaped object inside of an escaped object is escaped twice, which the depth
+// does at once instead of passing the output through a sink per level
+class SILK_EXPORT SilkEscapeSink : public SilkOutputSink
+{
+public:
+    enum Mode {
+        Text,
+        Attribute
+    };
+
+    explicit SilkEscapeSink(SilkOutputSink &sink, Mode mode = Text, int depth = 1);
+
+    SilkOutputSink &sink() const { return m_sink; }
+    Mode mode() const { return m_mode; }
+    int depth() const { return m_depth; }
+
+    static QString escape(const QString &source, Mode mode = Text);
+
+protected:
+    virtual void writeData(const char *data, int size);
+
+private:
+    SilkOutputSink &m_sink;
+    Mode m_mode;
+    int m_depth;
+    QByteArray m_prefix;
+};
+
+#endif // SILKOUTPUTSINK_H
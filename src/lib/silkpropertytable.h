@@ -0,0 +1,78 @@
+/* Copyright (c) 2012 Silk Project.
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Silk nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL SILK BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef SILKPROPERTYTABLE_H
+#define SILKPROPERTYTABLE_H
+
+#include <QtCore/QByteArray>
+#include <QtCore/QHash>
+#include <QtCore/QMetaObject>
+#include <QtCore/QThreadStorage>
+#include <QtCore/QVector>
+
+// the entries an object renders from its properties, worked out once per type. every thread keeps
+// tables of its own, so reading them takes no lock. qml objects have meta objects of their own, so
+// types are told apart by class name. a qml file compiled again gets new class names, so the tables
+// are dropped when there are too many. the table returned is valid until the next call
+template<typename T>
+class SilkPropertyTable
+{
+public:
+    typedef QVector<T> (*Builder)(const QMetaObject *metaObject);
+
+    static const QVector<T> &of(const QMetaObject *metaObject, Builder builder)
+    {
+        static QThreadStorage<QHash<QByteArray, SilkPropertyTable> *> storage;
+        if (!storage.hasLocalData())
+            storage.setLocalData(new QHash<QByteArray, SilkPropertyTable>);
+        QHash<QByteArray, SilkPropertyTable> *tables = storage.localData();
+
+        const char *className = metaObject->className();
+        typename QHash<QByteArray, SilkPropertyTable>::iterator it = tables->find(QByteArray::fromRawData(className, qstrlen(className)));
+        if (it == tables->end()) {
+            if (tables->size() >= MaxTables)
+                tables->clear();
+            it = tables->insert(QByteArray(className), SilkPropertyTable());
+        }
+
+        int count = metaObject->propertyCount();
+        if (it->m_propertyCount != count) {
+            it->m_propertyCount = count;
+            it->m_entries = builder(metaObject);
+        }
+        return it->m_entries;
+    }
+
+    SilkPropertyTable() : m_propertyCount(-1) {}
+
+private:
+    enum { MaxTables = 512 };
+
+    int m_propertyCount;
+    QVector<T> m_entries;
+};
+
+#endif // SILKPROPERTYTABLE_H
@@ -26,16 +26,31 @@
 
 #include "silkserver.h"
 #include "silkconfig.h"
+#include "silkcompressor.h"
+#include "silkhttp.h"
 
+#include <QtCore/QCache>
 #include <QtCore/QCoreApplication>
 #include <QtCore/QDebug>
 #include <QtCore/QDateTime>
 #include <QtCore/QDir>
 #include <QtCore/QFile>
+#include <QtCore/QFileSystemWatcher>
+#include <QtCore/QLocale>
 #include <QtCore/QMimeDatabase>
 #include <QtCore/QPluginLoader>
 #include <QtCore/QRegularExpression>
+#include <QtCore/QSet>
+#include <QtCore/QThread>
 #include <QtCore/QUrl>
+#include <QtCore/QUuid>
+#include <QtCore/QVector>
+
+#include <algorithm>
+
+#ifdef Q_OS_UNIX
+#include <unistd.h>
+#endif
 
 #include <qhttprequest.h>
 #include <qhttpreply.h>
@@ -46,44 +61,293 @@
 #include <silkprotocolhandlerinterface.h>
 #include <silkabstractprotocolhandler.h>
 
-typedef QPair<QRegularExpression, QString> RewriteRule;
+class RewriteRule
+{
+public:
+    RewriteRule(const QString &pattern, const QString &replacement);
+
+    bool isValid() const { return regularExpression.isValid(); }
+    const QString &prefix() const { return literalPrefix; }
+    bool rewrite(const QString &url, QString *ret) const;
+
+private:
+    QRegularExpression regularExpression;
+    QString literalPrefix;
+    // literal text followed by the index of the captured text, -1 for none
+    QList<QPair<QString, int> > replacement;
+};
+
+// dispatches on the literal prefixes of the rules, so only the rules which can match are evaluated
+class RewriteRules
+{
+public:
+    RewriteRules();
+
+    void append(const RewriteRule &rule);
+    void setCacheSize(int size) { cache.setMaxCost(size); }
+    bool rewrite(const QString &url, QString *ret);
+
+private:
+    struct Node {
+        QHash<QChar, int> children;
+        QList<int> rules;
+    };
+
+    QList<RewriteRule> rules;
+    QVector<Node> nodes;
+    QCache<QString, QString> cache;
+};
+
+typedef QPair<qint64, qint64> ByteRange;
+
+struct StaticFile
+{
+    QDateTime modified;
+    qint64 size;
+    QByteArray data;
+};
+
+// sends a file in slices as the reply drains, so that the file is never held in memory as a whole
+class FileStream : public QObject
+{
+    Q_OBJECT
+public:
+    FileStream(const QString &fileName, QHttpReply *reply, qint64 chunkSize);
+    ~FileStream();
+
+    bool open(bool map);
+    void setEncoding(SilkCompressor::Encoding encoding);
+    void append(const QByteArray &data);
+    void append(const ByteRange &range);
+
+public slots:
+    void writeChunk();
+
+private:
+    void write(const char *data, qint64 size);
+
+    struct Segment {
+        QByteArray data;
+        ByteRange range;
+    };
+
+    QFile file;
+    QHttpReply *reply;
+    bool mapped;
+    QList<Segment> segments;
+    qint64 pos;
+    qint64 chunkSize;
+    SilkCompressor *compressor;
+};
 
 class SilkServer::Private : public QObject
 {
     Q_OBJECT
 public:
-    Private(SilkServer *parent);
+    Private(SilkServer *parent, qintptr socketDescriptor = -1);
+    ~Private();
 
 private slots:
     void incomingConnection(QHttpRequest *request, QHttpReply *reply);
     void incomingConnection(QWebSocket *socket);
 
 private:
+    class Worker;
+    // what a path in a document root is served as
+    struct Resolution {
+        QFileInfo fileInfo;
+        QUrl url;
+        QString mime;
+        QByteArray contentType;
+        SilkAbstractMimeHandler *handler;
+        // precompressed siblings such as foo.css.gz
+        QMap<SilkCompressor::Encoding, QString> variants;
+        bool cached;
+    };
+
+    void startWorkers();
     QString documentRootForRequest(const QUrl &url) const;
+    int resolve(const QString &documentRoot, const QString &path, Resolution *resolution);
+    Resolution resolve(const QFileInfo &fileInfo) const;
+    void watch(const QString &documentRoot, const QFileInfo &fileInfo);
     void load(const QFileInfo &fileInfo, QHttpRequest *request, QHttpReply *reply, const QString &message = QString());
-    void loadFile(const QFileInfo &fileInfo, QHttpRequest *request, QHttpReply *reply);
+    void load(const Resolution &resolution, QHttpRequest *request, QHttpReply *reply, const QString &message = QString());
+    void loadFile(const QFileInfo &fileInfo, const QByteArray &contentType, const QMap<SilkCompressor::Encoding, QString> &variants, QHttpRequest *request, QHttpReply *reply);
+    bool readCache(const QString &key, const QDateTime &modified, qint64 size, QByteArray *data);
+    void writeCache(const QString &key, const QDateTime &modified, qint64 size, const QByteArray &data);
     void loadUrl(const QUrl &url, QHttpRequest *request, QHttpReply *reply, const QString &message = QString());
-    void load(const QFileInfo &fileInfo, QWebSocket *socket, const QString &message = QString());
+    void load(const Resolution &resolution, QWebSocket *socket, const QString &message = QString());
     void loadUrl(const QUrl &url, QWebSocket *socket, const QString &message = QString());
 
 private slots:
     void error(int statusCode, QHttpRequest *request, QHttpReply *reply, const QString &message = QString());
     void error(int statusCode, QWebSocket *socket, const QString &message = QString());
+    void directoryChanged();
 
 private:
     SilkServer *q;
     QMimeDatabase mimeDatabase;
     QMap<QString, SilkAbstractMimeHandler*> mimeHandlers;
     QMap<QString, SilkAbstractProtocolHandler*> protocolHandlers;
-    QList<RewriteRule> rewriteRules;
+    RewriteRules rewriteRules;
+    QCache<QString, Resolution> resolutionCache;
+    QFileSystemWatcher fileSystemWatcher;
+    QSet<QString> watchedDirectories;
+    QCache<QString, StaticFile> fileCache;
+    qint64 fileCacheMax;
+    qint64 streamThreshold;
+    qint64 streamChunk;
+    QList<Worker *> workers;
 public:
     QMap<QString, QString> documentRoots;
 };
 
-SilkServer::Private::Private(SilkServer *parent)
+// runs an own SilkServer, and so own mime handlers and QQmlEngine, on a duplicated listening socket
+class SilkServer::Private::Worker : public QThread
+{
+public:
+    Worker(qintptr socketDescriptor, QObject *parent = 0)
+        : QThread(parent)
+        , socketDescriptor(socketDescriptor)
+    {
+    }
+
+protected:
+    virtual void run()
+    {
+        SilkServer server(socketDescriptor);
+        exec();
+    }
+
+private:
+    qintptr socketDescriptor;
+};
+
+RewriteRule::RewriteRule(const QString &pattern, const QString &replacement)
+    : regularExpression(pattern)
+{
+#if QT_VERSION >= QT_VERSION_CHECK(5, 4, 0)
+    regularExpression.optimize();
+#endif
+
+    // the literal text an anchored pattern starts with, alternations can not be dispatched on
+    if (pattern.startsWith(QLatin1Char('^')) && !pattern.contains(QLatin1Char('|'))) {
+        static const QString special(QStringLiteral("\\.^$?*+()[]{}"));
+        for (int i = 1; i < pattern.length(); i++) {
+            QChar ch = pattern.at(i);
+            if (ch == QLatin1Char('\\') && i + 1 < pattern.length() && !pattern.at(i + 1).isLetterOrNumber()) {
+                ch = pattern.at(++i);
+            } else if (special.contains(ch)) {
+                // a quantifier makes the previous character optional
+                if (ch == QLatin1Char('?') || ch == QLatin1Char('*') || ch == QLatin1Char('{'))
+                    literalPrefix.chop(1);
+                break;
+            }
+            literalPrefix.append(ch);
+        }
+    }
+
+    QString literal;
+    for (int i = 0; i < replacement.length(); i++) {
+        QChar ch = replacement.at(i);
+        if (ch == QLatin1Char('$') && i + 1 < replacement.length() && replacement.at(i + 1).isDigit()) {
+            this->replacement.append(qMakePair(literal, replacement.at(++i).digitValue()));
+            literal.clear();
+        } else {
+            literal.append(ch);
+        }
+    }
+    this->replacement.append(qMakePair(literal, -1));
+}
+
+bool RewriteRule::rewrite(const QString &url, QString *ret) const
+{
+    QRegularExpressionMatch match = regularExpression.match(url);
+    if (!match.hasMatch()) return false;
+
+    ret->clear();
+    typedef QPair<QString, int> Part;
+    foreach (const Part &part, replacement) {
+        ret->append(part.first);
+        if (part.second < 0) continue;
+        if (part.second <= match.lastCapturedIndex()) {
+            ret->append(match.capturedRef(part.second));
+        } else {
+            ret->append(QLatin1Char('$'));
+            ret->append(QString::number(part.second));
+        }
+    }
+    return true;
+}
+
+RewriteRules::RewriteRules()
+    : nodes(1)
+{
+}
+
+void RewriteRules::append(const RewriteRule &rule)
+{
+    int node = 0;
+    foreach (const QChar &ch, rule.prefix()) {
+        int child = nodes.at(node).children.value(ch, -1);
+        if (child < 0) {
+            child = nodes.count();
+            nodes[node].children.insert(ch, child);
+            nodes.append(Node());
+        }
+        node = child;
+    }
+    nodes[node].rules.append(rules.count());
+    rules.append(rule);
+}
+
+bool RewriteRules::rewrite(const QString &url, QString *ret)
+{
+    if (rules.isEmpty()) return false;
+
+    QString *cached = cache.object(url);
+    if (cached) {
+        if (cached->isNull()) return false;
+        *ret = *cached;
+        return true;
+    }
+
+    // rules of all the prefixes of url, evaluated in the configured order
+    QList<int> candidates = nodes.at(0).rules;
+    int node = 0;
+    foreach (const QChar &ch, url) {
+        node = nodes.at(node).children.value(ch, -1);
+        if (node < 0) break;
+        candidates.append(nodes.at(node).rules);
+    }
+    std::sort(candidates.begin(), candidates.end());
+
+    bool matched = false;
+    foreach (int index, candidates) {
+        if (rules.at(index).rewrite(url, ret)) {
+            matched = true;
+            break;
+        }
+    }
+    // a null string means that no rule matched, so a rewrite to nothing is kept as an empty one
+    QString *value = new QString;
+    if (matched)
+        *value = ret->isNull() ? QString(QLatin1String("")) : *ret;
+    cache.insert(url, value);
+    return matched;
+}
+
+SilkServer::Private::Private(SilkServer *parent, qintptr socketDescriptor)
     : QObject(parent)
     , q(parent)
+    , fileCacheMax(SilkConfig::value("cache.file.max", 1048576).toLongLong())
+    , streamThreshold(SilkConfig::value("stream.threshold", 4194304).toLongLong())
+    , streamChunk(SilkConfig::value("stream.chunk", 262144).toLongLong())
 {
+    fileCache.setMaxCost(SilkConfig::value("cache.file.size", 33554432).toInt());
+    resolutionCache.setMaxCost(SilkConfig::value("cache.resolution", 1024).toInt());
+    connect(&fileSystemWatcher, SIGNAL(directoryChanged(QString)), this, SLOT(directoryChanged()));
+
     QDir appDir = QCoreApplication::applicationDirPath();
     QDir rootDir = appDir;
     QString appPath(SILK_APP_PATH);
@@ -211,20 +475,71 @@ SilkServer::Private::Private(SilkServer *parent)
     foreach (const QVariant &val, SilkConfig::value("rewrite").toList()) {
         QVariantMap map = val.toMap();
         foreach (const QString &key, map.keys()) {
-            rewriteRules.append(RewriteRule(QRegularExpression(key), map.value(key).toString()));
+            RewriteRule rule(key, map.value(key).toString());
+            if (rule.isValid()) {
+                rewriteRules.append(rule);
+            } else {
+                qWarning() << "Configuration: rewrite rule" << key << "is ignored because of invalid pattern.";
+            }
         }
     }
+    rewriteRules.setCacheSize(SilkConfig::value("cache.rewrite", 1024).toInt());
 
+    // every worker has own handlers, so each of them warms up before it takes requests
+    if (SilkConfig::value("cache.warmup").toBool()) {
+        foreach (SilkAbstractMimeHandler *handler, mimeHandlers.values().toSet()) {
+            foreach (const QString &documentRoot, documentRoots.values()) {
+                handler->warmUp(documentRoot);
+            }
+        }
+    }
 
+    if (socketDescriptor != -1) {
+        if (!q->setSocketDescriptor(socketDescriptor)) {
+            qWarning() << q->errorString();
+        }
+        return;
+    }
 
     if (q->listen(address, port)) {
         qDebug() << tr("silk is running on %1").arg(port);
+        startWorkers();
     } else {
         qWarning() << q->errorString();
         QMetaObject::invokeMethod(QCoreApplication::instance(), "quit", Qt::QueuedConnection);
     }
 }
 
+SilkServer::Private::~Private()
+{
+    foreach (Worker *worker, workers) {
+        worker->quit();
+        worker->wait();
+    }
+}
+
+void SilkServer::Private::startWorkers()
+{
+    int count = SilkConfig::value("workers").toInt();
+    if (count < 2) return;
+#ifdef Q_OS_UNIX
+    // the main thread is the first worker, the others accept on their own copy of the listening socket
+    for (int i = 1; i < count; i++) {
+        qintptr socketDescriptor = ::dup(q->socketDescriptor());
+        if (socketDescriptor < 0) {
+            qWarning() << "The worker" << i << "is not available.";
+            break;
+        }
+        Worker *worker = new Worker(socketDescriptor, this);
+        workers.append(worker);
+        worker->start();
+    }
+    qDebug() << tr("silk is running with %1 workers").arg(workers.count() + 1);
+#else
+    qWarning() << "Configuration: workers is not supported on this platform.";
+#endif
+}
+
 QString SilkServer::Private::documentRootForRequest(const QUrl &url) const
 {
     QString ret(":/contents");
@@ -241,17 +556,9 @@ void SilkServer::Private::incomingConnection(QHttpRequest *request, QHttpReply *
 //    qDebug() << Q_FUNC_INFO << __LINE__ << request->url();
 
     reply->setRawHeader("Server", "Silk");
-    QString str = request->url().toString();
-    foreach (const RewriteRule &rule, rewriteRules) {
-        QRegularExpressionMatch match = rule.first.match(str);
-        if (match.hasMatch()) {
-            QString url = rule.second;
-            for (int i = 0; i <= match.lastCapturedIndex(); i++) {
-                url = url.replace(QString("$%1").arg(i), match.captured(i));
-            }
-            request->setUrl(QUrl(url));
-            break;
-        }
+    QString url;
+    if (rewriteRules.rewrite(request->url().toString(), &url)) {
+        request->setUrl(QUrl(url));
     }
 
     QString documentRoot = documentRootForRequest(request->url());
@@ -261,41 +568,28 @@ void SilkServer::Private::incomingConnection(QHttpRequest *request, QHttpReply *
         url.setPath(request->url().path());
         loadUrl(url, request, reply);
     } else {
-        QString fileName(documentRoot + request->url().path());
-        QFileInfo fileInfo(fileName);
-        if (fileInfo.isDir()) {
-            if (request->url().path().endsWith("/")) {
-                fileName = fileName + QStringLiteral("/index.qml");
-                fileInfo = QFileInfo(fileName);
-            } else {
-                QUrl url(request->url());
-                url.setPath(url.path() + "/");
-                error(301, request, reply, url.toString());
-                return;
-            }
-        }
-
-        if (fileInfo.exists()) {
-            load(fileInfo, request, reply);
-        } else {
+        Resolution resolution;
+        switch (resolve(documentRoot, request->url().path(), &resolution)) {
+        case 200:
+            load(resolution, request, reply);
+            break;
+        case 301: {
+            QUrl url(request->url());
+            url.setPath(url.path() + "/");
+            error(301, request, reply, url.toString());
+            break; }
+        default:
             error(404, request, reply, request->url().toString());
+            break;
         }
     }
 }
 
 void SilkServer::Private::incomingConnection(QWebSocket *socket)
 {
-    QString str = socket->url().toString();
-    foreach (const RewriteRule &rule, rewriteRules) {
-        QRegularExpressionMatch match = rule.first.match(str);
-        if (match.hasMatch()) {
-            QString url = rule.second;
-            for (int i = 0; i <= match.lastCapturedIndex(); i++) {
-                url = url.replace(QString("$%1").arg(i), match.captured(i));
-            }
-            socket->setUrl(QUrl(url));
-            break;
-        }
+    QString url;
+    if (rewriteRules.rewrite(socket->url().toString(), &url)) {
+        socket->setUrl(QUrl(url));
     }
 
     QString documentRoot = documentRootForRequest(socket->url());
@@ -305,91 +599,404 @@ void SilkServer::Private::incomingConnection(QWebSocket *socket)
         url.setPath(socket->url().path());
         loadUrl(url, socket);
     } else {
-        QString fileName(documentRoot + socket->url().path());
-        QFileInfo fileInfo(fileName);
-        if (fileInfo.isDir()) {
-            if (socket->url().path().endsWith("/")) {
-                fileName = fileName + QStringLiteral("/index.qml");
-                fileInfo = QFileInfo(fileName);
-            } else {
-                QUrl url(socket->url());
-                url.setPath(url.path() + "/");
-                error(301, socket, url.toString());
-                return;
-            }
+        Resolution resolution;
+        switch (resolve(documentRoot, socket->url().path(), &resolution)) {
+        case 200:
+            load(resolution, socket);
+            break;
+        case 301: {
+            QUrl url(socket->url());
+            url.setPath(url.path() + "/");
+            error(301, socket, url.toString());
+            break; }
+        default:
+            error(404, socket, socket->url().toString());
+            break;
         }
+    }
+}
 
-        if (fileInfo.exists()) {
-            load(fileInfo, socket);
+// returns 200 with the resolution of path, 301 for a directory without trailing slash or 404
+int SilkServer::Private::resolve(const QString &documentRoot, const QString &path, Resolution *resolution)
+{
+    QString fileName(documentRoot + path);
+    Resolution *cached = resolutionCache.object(fileName);
+    if (cached) {
+        *resolution = *cached;
+        return 200;
+    }
+
+    QFileInfo fileInfo(fileName);
+    if (fileInfo.isDir()) {
+        if (path.endsWith("/")) {
+            fileInfo = QFileInfo(fileName + QStringLiteral("/index.qml"));
         } else {
-            error(404, socket, socket->url().toString());
+            return 301;
         }
     }
+
+    if (!fileInfo.exists()) return 404;
+
+    *resolution = resolve(fileInfo);
+    // resources never change, files are valid as long as no directory on the way changes
+    if (!fileInfo.filePath().startsWith(":/")) {
+        watch(documentRoot, fileInfo);
+    }
+    Resolution *entry = new Resolution(*resolution);
+    entry->cached = true;
+    resolutionCache.insert(fileName, entry);
+    return 200;
 }
 
-void SilkServer::Private::load(const QFileInfo &fileInfo, QHttpRequest *request, QHttpReply *reply, const QString &message)
+static bool needsCharset(const QString &mime)
 {
-    QStringList mimeTypeListNeedCharset;
-    mimeTypeListNeedCharset << QStringLiteral("text/x-qml")
-                            << QStringLiteral("text/css")
-                            << QStringLiteral("text/html")
-                            << QStringLiteral("text/plain")
-                            << QStringLiteral("image/svg+xml")
-                            << QStringLiteral("application/javascript")
-                            << QStringLiteral("application/x-javascript")
-                            << QStringLiteral("application/xml")
-                            << QStringLiteral("application/atom")
-                            << QStringLiteral("application/rss+xml")
-                            << QStringLiteral("application/x-shockwave-flash");
-    QMimeType mimeType = mimeDatabase.mimeTypeForFile(fileInfo.fileName(), QMimeDatabase::MatchExtension);
-    QString mime = mimeType.name();
-    QString contentType = mime;
-    if (mimeTypeListNeedCharset.contains(mime)) {
-        contentType.append(QStringLiteral("; charset=utf-8"));
+    static const QSet<QString> mimeTypes = QSet<QString>()
+            << QStringLiteral("text/x-qml")
+            << QStringLiteral("text/css")
+            << QStringLiteral("text/html")
+            << QStringLiteral("text/plain")
+            << QStringLiteral("image/svg+xml")
+            << QStringLiteral("application/javascript")
+            << QStringLiteral("application/x-javascript")
+            << QStringLiteral("application/xml")
+            << QStringLiteral("application/atom")
+            << QStringLiteral("application/rss+xml")
+            << QStringLiteral("application/x-shockwave-flash");
+    return mimeTypes.contains(mime);
+}
+
+SilkServer::Private::Resolution SilkServer::Private::resolve(const QFileInfo &fileInfo) const
+{
+    Resolution ret;
+    ret.fileInfo = fileInfo;
+    ret.cached = false;
+    if (fileInfo.filePath().startsWith(":/")) {
+        ret.url = QUrl("qrc" + fileInfo.absoluteFilePath());
+    } else {
+        ret.url = QUrl::fromLocalFile(fileInfo.absoluteFilePath());
+    }
+    ret.mime = mimeDatabase.mimeTypeForFile(fileInfo.fileName(), QMimeDatabase::MatchExtension).name();
+    ret.contentType = ret.mime.toUtf8();
+    if (needsCharset(ret.mime)) {
+        ret.contentType.append("; charset=utf-8");
+    }
+    ret.handler = mimeHandlers.value(ret.mime);
+    if (!ret.handler) {
+        ret.handler = mimeHandlers.value(ret.mime.section(QLatin1Char('/'), 0, 0) + QStringLiteral("/*"));
     }
+    if (SilkCompressor::isCompressible(ret.contentType)) {
+        QList<SilkCompressor::Encoding> encodings;
+        encodings << SilkCompressor::Gzip << SilkCompressor::Brotli;
+        foreach (SilkCompressor::Encoding encoding, encodings) {
+            QString fileName = fileInfo.filePath() + QLatin1Char('.') + QString::fromLatin1(SilkCompressor::name(encoding));
+            if (QFile::exists(fileName)) {
+                ret.variants.insert(encoding, fileName);
+            }
+        }
+    }
+    return ret;
+}
+
+void SilkServer::Private::watch(const QString &documentRoot, const QFileInfo &fileInfo)
+{
+    QString root = QDir(documentRoot).absolutePath();
+    QDir dir = fileInfo.absoluteDir();
+    QStringList paths;
+    while (true) {
+        QString path = dir.absolutePath();
+        if (watchedDirectories.contains(path)) break;
+        watchedDirectories.insert(path);
+        paths.append(path);
+        if (!path.startsWith(root) || path == root || !dir.cdUp()) break;
+    }
+    if (!paths.isEmpty()) {
+        fileSystemWatcher.addPaths(paths);
+    }
+}
+
+void SilkServer::Private::directoryChanged()
+{
+    // a rename or removal anywhere may change how any of the paths below resolve
+    resolutionCache.clear();
+    if (!watchedDirectories.isEmpty()) {
+        fileSystemWatcher.removePaths(watchedDirectories.toList());
+        watchedDirectories.clear();
+    }
+}
+
+void SilkServer::Private::load(const QFileInfo &fileInfo, QHttpRequest *request, QHttpReply *reply, const QString &message)
+{
+    load(resolve(fileInfo), request, reply, message);
+}
+
+void SilkServer::Private::load(const Resolution &resolution, QHttpRequest *request, QHttpReply *reply, const QString &message)
+{
     reply->setStatus(200);
-    reply->setRawHeader("Content-Type", contentType.toUtf8());
-    if (!mimeHandlers.contains(mime)) {
-        mime = mime.section(QLatin1Char('/'), 0, 0) + QStringLiteral("/*");
+    reply->setRawHeader("Content-Type", resolution.contentType);
+    if (resolution.handler && resolution.handler->load(resolution.url, request, reply, message)) return;
+
+    if (resolution.cached) {
+        // the cached file info holds the size and modification time of when it was resolved
+        QFileInfo fileInfo(resolution.fileInfo);
+        fileInfo.refresh();
+        loadFile(fileInfo, resolution.contentType, resolution.variants, request, reply);
+    } else {
+        loadFile(resolution.fileInfo, resolution.contentType, resolution.variants, request, reply);
     }
-    if (mimeHandlers.contains(mime)) {
-        QUrl url;
-        if (fileInfo.filePath().startsWith(":/")) {
-            url = QUrl("qrc" + fileInfo.absoluteFilePath());
+}
+
+static QByteArray httpDate(const QDateTime &dateTime)
+{
+    return QLocale::c().toString(dateTime.toUTC(), QStringLiteral("ddd, dd MMM yyyy hh:mm:ss 'GMT'")).toLatin1();
+}
+
+static QDateTime parseHttpDate(const QByteArray &value)
+{
+    QDateTime ret = QLocale::c().toDateTime(QString::fromLatin1(value.trimmed()), QStringLiteral("ddd, dd MMM yyyy hh:mm:ss 'GMT'"));
+    ret.setTimeSpec(Qt::UTC);
+    return ret;
+}
+
+// returns false when the header has to be ignored, an empty list means nothing is satisfiable
+static bool parseRanges(const QByteArray &value, qint64 size, QList<ByteRange> *ranges)
+{
+    if (!value.startsWith("bytes=")) return false;
+    QList<QByteArray> specs = value.mid(6).split(',');
+    if (specs.count() > 32) return false;
+    foreach (QByteArray spec, specs) {
+        spec = spec.trimmed();
+        int index = spec.indexOf('-');
+        if (index < 0) return false;
+        bool ok = true;
+        if (index == 0) {
+            qint64 length = spec.mid(1).toLongLong(&ok);
+            if (!ok) return false;
+            if (length > 0 && size > 0)
+                ranges->append(ByteRange(qMax(Q_INT64_C(0), size - length), size - 1));
         } else {
-            url = QUrl::fromLocalFile(fileInfo.absoluteFilePath());
-        }
-        bool ret = mimeHandlers[mime]->load(url, request, reply, message);
-        if (!ret) {
-            loadFile(fileInfo, request, reply);
+            qint64 first = spec.left(index).toLongLong(&ok);
+            if (!ok) return false;
+            qint64 last = size - 1;
+            if (index < spec.length() - 1) {
+                last = spec.mid(index + 1).toLongLong(&ok);
+                if (!ok || last < first) return false;
+                last = qMin(last, size - 1);
+            }
+            if (first < size)
+                ranges->append(ByteRange(first, last));
         }
-    } else {
-        loadFile(fileInfo, request, reply);
     }
+    return true;
+}
+
+static QByteArray contentRange(const ByteRange &range, qint64 size)
+{
+    return QByteArray("bytes ") + QByteArray::number(range.first) + '-' + QByteArray::number(range.second) + '/' + QByteArray::number(size);
 }
 
-void SilkServer::Private::loadFile(const QFileInfo &fileInfo, QHttpRequest *request, QHttpReply *reply)
+void SilkServer::Private::loadFile(const QFileInfo &fileInfo, const QByteArray &contentType, const QMap<SilkCompressor::Encoding, QString> &variants, QHttpRequest *request, QHttpReply *reply)
 {
     if (fileInfo.fileName().startsWith(".")) {
         error(403, request, reply, request->url().toString());
-    } else {
-        // TODO cache
-        QFile file(fileInfo.absoluteFilePath());
-        if (file.open(QFile::ReadOnly)) {
-            QDateTime lastModified = fileInfo.lastModified();
-            if (lastModified.isNull()) {
-                lastModified.setTime_t(0);
-            }
-            reply->setRawHeader("Last-Modified", lastModified.toUTC().toString("ddd, d, MMM yyyy hh:mm:ss UTC").toUtf8());
-            while (!file.atEnd()) {
-                reply->write(file.read(1024 * 1024));
-            }
-            file.close();
+        return;
+    }
+
+    QString filePath = fileInfo.absoluteFilePath();
+    qint64 size = fileInfo.size();
+    QDateTime lastModified = fileInfo.lastModified();
+    if (lastModified.isNull()) {
+        lastModified.setTime_t(0);
+    }
+    QByteArray range = SilkHttp::header(request, "Range");
+
+    // ranges are always of the identity encoding
+    SilkCompressor::Encoding encoding = SilkCompressor::Identity;
+    QFileInfo variant;
+    if (range.isEmpty()) {
+        QByteArray acceptEncoding = SilkHttp::header(request, "Accept-Encoding");
+        encoding = SilkCompressor::negotiate(acceptEncoding, contentType);
+        // a precompressed sibling costs no compression at all, the later one wins a tie
+        qreal quality = encoding == SilkCompressor::Identity ? 0.0 : SilkCompressor::quality(acceptEncoding, encoding);
+        QMapIterator<SilkCompressor::Encoding, QString> i(variants);
+        while (i.hasNext()) {
+            i.next();
+            qreal q = SilkCompressor::quality(acceptEncoding, i.key());
+            if (q <= 0.0 || q < quality) continue;
+            QFileInfo info(i.value());
+            // a sibling older than the file is out of date
+            if (info.lastModified().isValid() && info.lastModified() < lastModified) continue;
+            quality = q;
+            encoding = i.key();
+            variant = info;
+        }
+    }
+
+    // the etag is of the file sent, a precompressed sibling is replaced apart from the file
+    QDateTime etagModified = lastModified;
+    qint64 etagSize = size;
+    if (!variant.filePath().isEmpty() && variant.lastModified().isValid()) {
+        etagModified = variant.lastModified();
+        etagSize = variant.size();
+    }
+    QByteArray etag = QByteArray::number(etagModified.toMSecsSinceEpoch(), 16) + '-' + QByteArray::number(etagSize, 16);
+    if (encoding != SilkCompressor::Identity) {
+        etag += '-' + SilkCompressor::name(encoding);
+    }
+    etag = '"' + etag + '"';
+    reply->setRawHeader("Last-Modified", httpDate(lastModified));
+    reply->setRawHeader("ETag", etag);
+    reply->setRawHeader("Accept-Ranges", "bytes");
+    if (SilkCompressor::isCompressible(contentType)) {
+        reply->setRawHeader("Vary", "Accept-Encoding");
+    }
+    if (encoding != SilkCompressor::Identity) {
+        reply->setRawHeader("Content-Encoding", SilkCompressor::name(encoding));
+    }
+
+    bool head = (request->method() == "HEAD");
+    if (head || request->method() == "GET") {
+        QByteArray ifNoneMatch = SilkHttp::header(request, "If-None-Match");
+        QByteArray ifModifiedSince = SilkHttp::header(request, "If-Modified-Since");
+        bool notModified = false;
+        if (!ifNoneMatch.isEmpty()) {
+            notModified = SilkHttp::matchETag(ifNoneMatch, etag);
+        } else if (!ifModifiedSince.isEmpty()) {
+            QDateTime since = parseHttpDate(ifModifiedSince);
+            notModified = since.isValid() && lastModified.toMSecsSinceEpoch() / 1000 <= since.toMSecsSinceEpoch() / 1000;
+        }
+        if (notModified) {
+            reply->setStatus(304);
             reply->close();
-        } else {
+            return;
+        }
+    }
+
+    QList<ByteRange> ranges;
+    if (!head && request->method() == "GET" && !range.isEmpty()) {
+        QByteArray ifRange = SilkHttp::header(request, "If-Range").trimmed();
+        if (ifRange.isEmpty() || ifRange == etag || ifRange == httpDate(lastModified)) {
+            if (!parseRanges(range, size, &ranges)) {
+                ranges.clear();
+            } else if (ranges.isEmpty()) {
+                reply->setStatus(416);
+                reply->setRawHeader("Content-Range", QByteArray("bytes */") + QByteArray::number(size));
+                reply->close();
+                return;
+            }
+        }
+    }
+
+    // the headers are all decided, HEAD does not need the file contents at all
+    if (head) {
+        reply->close();
+        return;
+    }
+
+    QByteArray boundary;
+    if (ranges.count() == 1) {
+        reply->setStatus(206);
+        reply->setRawHeader("Content-Range", contentRange(ranges.first(), size));
+    } else if (ranges.count() > 1) {
+        boundary = QUuid::createUuid().toRfc4122().toHex();
+        reply->setStatus(206);
+        reply->setRawHeader("Content-Type", QByteArray("multipart/byteranges; boundary=") + boundary);
+    }
+    if (!variant.filePath().isEmpty()) {
+        filePath = variant.absoluteFilePath();
+        size = variant.size();
+        lastModified = variant.lastModified();
+    }
+    if (ranges.isEmpty()) {
+        ranges.append(ByteRange(0, size - 1));
+    }
+
+    // fileInfo is already stat()ed, so a cache hit needs no file I/O at all
+    QByteArray data;
+    bool inMemory = readCache(filePath, lastModified, size, &data);
+    if (!inMemory && size <= fileCacheMax && size <= fileCache.maxCost()) {
+        QFile file(filePath);
+        if (!file.open(QFile::ReadOnly)) {
             error(403, request, reply, request->url().toString());
+            return;
         }
+        data = file.readAll();
+        file.close();
+        inMemory = true;
+        writeCache(filePath, lastModified, size, data);
     }
+
+    if (inMemory) {
+        // the compressed data is cached next to the file, so that each file is compressed only once
+        if (encoding != SilkCompressor::Identity && variant.filePath().isEmpty()) {
+            QString key = filePath + QLatin1Char(':') + QString::fromLatin1(SilkCompressor::name(encoding));
+            if (!readCache(key, lastModified, size, &data)) {
+                data = SilkCompressor::compress(data, encoding);
+                writeCache(key, lastModified, size, data);
+            }
+        }
+        foreach (const ByteRange &r, ranges) {
+            if (!boundary.isEmpty()) {
+                reply->write(QByteArray("--") + boundary + "\r\nContent-Type: " + contentType + "\r\nContent-Range: " + contentRange(r, size) + "\r\n\r\n");
+            }
+            if (r.first == 0 && r.second == size - 1) {
+                reply->write(data);
+            } else {
+                reply->write(data.constData() + r.first, r.second - r.first + 1);
+            }
+            if (!boundary.isEmpty()) {
+                reply->write("\r\n");
+            }
+        }
+        if (!boundary.isEmpty()) {
+            reply->write(QByteArray("--") + boundary + "--\r\n");
+        }
+        reply->close();
+        return;
+    }
+
+    FileStream *stream = new FileStream(filePath, reply, streamChunk);
+    if (!stream->open(streamThreshold > 0 && size >= streamThreshold)) {
+        delete stream;
+        error(403, request, reply, request->url().toString());
+        return;
+    }
+    if (variant.filePath().isEmpty())
+        stream->setEncoding(encoding);
+    foreach (const ByteRange &r, ranges) {
+        if (!boundary.isEmpty()) {
+            stream->append(QByteArray("--") + boundary + "\r\nContent-Type: " + contentType + "\r\nContent-Range: " + contentRange(r, size) + "\r\n\r\n");
+        }
+        stream->append(r);
+        if (!boundary.isEmpty()) {
+            stream->append(QByteArray("\r\n"));
+        }
+    }
+    if (!boundary.isEmpty()) {
+        stream->append(QByteArray("--") + boundary + "--\r\n");
+    }
+    QMetaObject::invokeMethod(stream, "writeChunk", Qt::QueuedConnection);
+}
+
+bool SilkServer::Private::readCache(const QString &key, const QDateTime &modified, qint64 size, QByteArray *data)
+{
+    StaticFile *staticFile = fileCache.object(key);
+    if (!staticFile) return false;
+    if (staticFile->modified != modified || staticFile->size != size) {
+        fileCache.remove(key);
+        return false;
+    }
+    *data = staticFile->data;
+    return true;
+}
+
+void SilkServer::Private::writeCache(const QString &key, const QDateTime &modified, qint64 size, const QByteArray &data)
+{
+    if (data.size() > fileCache.maxCost()) return;
+    StaticFile *staticFile = new StaticFile;
+    staticFile->modified = modified;
+    staticFile->size = size;
+    staticFile->data = data;
+    fileCache.insert(key, staticFile, data.size());
 }
 
 void SilkServer::Private::loadUrl(const QUrl &url, QHttpRequest *request, QHttpReply *reply, const QString &message)
@@ -414,18 +1021,12 @@ void SilkServer::Private::error(int statusCode, QHttpRequest *request, QHttpRepl
     }
 }
 
-void SilkServer::Private::load(const QFileInfo &fileInfo, QWebSocket *socket, const QString &message)
+void SilkServer::Private::load(const Resolution &resolution, QWebSocket *socket, const QString &message)
 {
-    QMimeType mimeType = mimeDatabase.mimeTypeForFile(fileInfo.fileName(), QMimeDatabase::MatchExtension);
-    QString mime = mimeType.name();
-    if (mimeHandlers.contains(mime)) {
-        QUrl url;
-        if (fileInfo.filePath().startsWith(":/")) {
-            url = QUrl("qrc" + fileInfo.absoluteFilePath());
-        } else {
-            url = QUrl::fromLocalFile(fileInfo.absoluteFilePath());
-        }
-        bool ret = mimeHandlers[mime]->load(url, socket, message);
+    // web sockets are served only by a handler for the exact mime type
+    SilkAbstractMimeHandler *handler = mimeHandlers.value(resolution.mime);
+    if (handler) {
+        bool ret = handler->load(resolution.url, socket, message);
         if (!ret) {
             error(401, socket, socket->url().toString());
         }
@@ -456,12 +1057,131 @@ void SilkServer::Private::error(int statusCode, QWebSocket *socket, const QStrin
     qDebug() << Q_FUNC_INFO << __LINE__;
 }
 
+FileStream::FileStream(const QString &fileName, QHttpReply *reply, qint64 chunkSize)
+    : QObject(reply)
+    , file(fileName)
+    , reply(reply)
+    , mapped(false)
+    , pos(0)
+    , chunkSize(qMax(chunkSize, Q_INT64_C(4096)))
+    , compressor(0)
+{
+    connect(reply, SIGNAL(bytesWritten(qint64)), this, SLOT(writeChunk()));
+}
+
+FileStream::~FileStream()
+{
+    delete compressor;
+}
+
+void FileStream::setEncoding(SilkCompressor::Encoding encoding)
+{
+    delete compressor;
+    compressor = 0;
+    if (encoding != SilkCompressor::Identity)
+        compressor = new SilkCompressor(encoding);
+}
+
+void FileStream::write(const char *data, qint64 size)
+{
+    if (compressor) {
+        reply->write(compressor->compress(data, size));
+    } else {
+        reply->write(data, size);
+    }
+}
+
+bool FileStream::open(bool map)
+{
+    if (!file.open(QFile::ReadOnly)) return false;
+    // a window of a chunk is mapped at a time, so that the file does not stay in memory as a whole
+    mapped = map;
+    return true;
+}
+
+void FileStream::append(const QByteArray &data)
+{
+    Segment segment;
+    segment.data = data;
+    segment.range = ByteRange(0, -1);
+    segments.append(segment);
+}
+
+void FileStream::append(const ByteRange &range)
+{
+    Segment segment;
+    segment.range = range;
+    segments.append(segment);
+}
+
+void FileStream::writeChunk()
+{
+    if (!file.isOpen()) return;
+    // wait for bytesWritten() while the reply still has a chunk to send
+    if (reply->bytesToWrite() > chunkSize) return;
+
+    if (!segments.isEmpty()) {
+        Segment &segment = segments.first();
+        if (!segment.data.isEmpty()) {
+            write(segment.data.constData(), segment.data.size());
+            segments.removeFirst();
+        } else {
+            qint64 offset = segment.range.first + pos;
+            qint64 size = qMin(chunkSize, segment.range.second + 1 - offset);
+            bool truncated = false;
+            if (size > 0) {
+                // touching a mapping beyond the end of a file truncated meanwhile raises SIGBUS
+                uchar *window = 0;
+                if (offset + size > file.size())
+                    truncated = true;
+                else if (mapped)
+                    window = file.map(offset, size);
+                if (window) {
+                    write(reinterpret_cast<const char *>(window), size);
+                    file.unmap(window);
+                } else if (!truncated && file.seek(offset)) {
+                    // resources and some file systems can not be mapped, they are read instead
+                    QByteArray buffer = file.read(size);
+                    truncated = (buffer.size() < size);
+                    write(buffer.constData(), buffer.size());
+                }
+                pos += size;
+            }
+            if (truncated) {
+                qWarning() << file.fileName() << "was truncated while being sent.";
+                segments.clear();
+            } else if (segment.range.first + pos > segment.range.second) {
+                segments.removeFirst();
+                pos = 0;
+            }
+        }
+    }
+
+    if (!segments.isEmpty()) {
+        if (reply->bytesToWrite() <= chunkSize) {
+            QMetaObject::invokeMethod(this, "writeChunk", Qt::QueuedConnection);
+        }
+    } else {
+        file.close();
+        if (compressor)
+            reply->write(compressor->finish());
+        reply->close();
+        deleteLater();
+    }
+}
+
 SilkServer::SilkServer(QObject *parent)
     : QHttpServer(parent)
     , d(new Private(this))
 {
 }
 
+SilkServer::SilkServer(qintptr socketDescriptor, QObject *parent)
+    : QHttpServer(parent)
+    , d(new Private(this, socketDescriptor))
+{
+}
+
 const QMap<QString, QString> &SilkServer::documentRoots() const
 {
     return d->documentRoots;
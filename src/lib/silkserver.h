@@ -46,6 +46,8 @@ signals:
     void documentRootsChanged(const QMap<QString, QString> &documentRoots);
 
 private:
+    explicit SilkServer(qintptr socketDescriptor, QObject *parent = 0);
+
     class Private;
     Private *d;
 };
@@ -1,11 +0,0 @@
-SILK_PLUGIN_TYPE = mimehandler
-include(../../../../silkplugin.pri)
-
-QT = core
-
-HEADERS += \
-    deflateplugin.h \
-    deflatehandler.h
-
-SOURCES += \
-    deflatehandler.cpp
@@ -1,3 +1,3 @@
 TEMPLATE = subdirs
-SUBDIRS = qml deflate
+SUBDIRS = qml
 
@@ -29,27 +29,100 @@
 #include <QtCore/QDebug>
 #include <QtCore/QDir>
 #include <QtCore/QFileInfo>
+#include <QtNetwork/QNetworkCookie>
 #include <qhttprequest.h>
 
+#include <silkconfig.h>
+#include <silkhttp.h>
+
+#ifdef Q_OS_UNIX
+#include <unistd.h>
+#endif
+
 HttpFileData::HttpFileData(QHttpFileData *data, QObject *parent)
     : QObject(parent)
+    , m_failed(false)
 {
+    static const qint64 threshold = SilkConfig::value("upload.threshold", 65536).toLongLong();
+    static const qint64 chunkSize = 65536;
+
     fileName(data->fileName());
     contentType(data->contentType());
-    if (m_file.open()) {
-        m_file.write(data->readAll());
-        m_file.close();
-        filePath(m_file.fileName());
+    if (data->size() <= threshold) {
+        m_data = data->readAll();
+        return;
+    }
+
+    if (!m_file.open()) {
+        qWarning() << m_file.fileName() << m_file.errorString();
+        m_failed = true;
+        return;
+    }
+    QByteArray buffer(chunkSize, Qt::Uninitialized);
+    qint64 size;
+    while ((size = data->read(buffer.data(), chunkSize)) > 0) {
+        if (m_file.write(buffer.constData(), size) != size) {
+            qWarning() << m_file.fileName() << m_file.errorString();
+            m_failed = true;
+            break;
+        }
+    }
+    if (size < 0) {
+        qWarning() << "failed to read" << data->fileName();
+        m_failed = true;
+    }
+    m_file.close();
+    if (!m_failed)
+        m_filePath = m_file.fileName();
+}
+
+const QString &HttpFileData::filePath()
+{
+    // a failed upload has no path, instead of one to a partial file. no reader ever sees the path
+    // change, so filePathChanged() is not emitted from here, which would re-evaluate the binding
+    // reading it
+    if (m_filePath.isEmpty() && !m_failed)
+        spool();
+    return m_filePath;
+}
+
+// spools the data once, a failure is not tried again on the next read
+bool HttpFileData::spool()
+{
+    bool ret = m_file.open() && (m_file.write(m_data) == m_data.size());
+    m_file.close();
+    if (ret) {
+        m_data.clear();
+        m_filePath = m_file.fileName();
+    } else {
+        qWarning() << m_file.fileName() << m_file.errorString();
+        m_failed = true;
     }
+    return ret;
 }
 
 bool HttpFileData::save(const QString &fileName)
 {
-    bool ret = false;
+    // data which could not be spooled is still in memory
+    if (m_failed && m_data.isEmpty()) return false;
+
     QFileInfo fi(fileName);
-    if (QDir::root().mkpath(fi.dir().absolutePath()))
-        ret = m_file.copy(fileName);
-    return ret;
+    if (!QDir::root().mkpath(fi.dir().absolutePath())) return false;
+
+    if (m_filePath.isEmpty()) {
+        QFile file(fileName);
+        if (file.exists() || !file.open(QFile::WriteOnly)) return false;
+        bool ret = (file.write(m_data) == m_data.size());
+        file.close();
+        return ret;
+    }
+
+#ifdef Q_OS_UNIX
+    // a hard link shares the data with the temporary file, which fails across file systems
+    if (::link(QFile::encodeName(m_filePath).constData(), QFile::encodeName(fi.absoluteFilePath()).constData()) == 0)
+        return true;
+#endif
+    return m_file.copy(fileName);
 }
 
 HttpObject::HttpObject(QObject *parent)
@@ -58,7 +131,69 @@ HttpObject::HttpObject(QObject *parent)
     , m_loading(false)
     , m_status(200)
     , m_escapeHTML(false)
+    , m_maxAge(0)
+    , m_etag(SilkConfig::value("cache.etag").toBool())
+    , m_dataRead(false)
+    , m_requestCookiesRead(false)
+    , m_paramsRead(false)
+{
+}
+
+void HttpObject::reset()
+{
+    m_remoteAddress.clear();
+    m_method.clear();
+    m_scheme.clear();
+    m_host.clear();
+    m_port = -1;
+    m_path.clear();
+    m_query.clear();
+    m_message.clear();
+    m_loading = false;
+    m_status = 200;
+    m_responseHeader.clear();
+    m_responseCookies.clear();
+    m_escapeHTML = false;
+    m_cacheControl.clear();
+    m_maxAge = 0;
+    m_vary.clear();
+    m_etag = SilkConfig::value("cache.etag").toBool();
+    setBody(0);
+    qDeleteAll(m_files);
+    m_files.clear();
+    setRequest(0);
+}
+
+const QString &HttpObject::data() const
+{
+    if (!m_dataRead) {
+        m_dataRead = true;
+        if (m_body)
+            m_data = QString::fromUtf8(m_body->readAll());
+    }
+    return m_data;
+}
+
+void HttpObject::setBody(QIODevice *body)
+{
+    if (m_body)
+        disconnect(m_body, 0, this, 0);
+    m_body = body;
+    m_data.clear();
+    m_dataRead = false;
+    if (m_body)
+        connect(m_body, SIGNAL(readyRead()), this, SIGNAL(readyRead()));
+}
+
+QByteArray HttpObject::readChunk(int maxSize)
+{
+    if (!m_body || maxSize <= 0) return QByteArray();
+    return m_body->read(maxSize);
+}
+
+bool HttpObject::atEnd() const
 {
+    return !m_body || m_body->atEnd();
 }
 
 QQmlListProperty<HttpFileData> HttpObject::files()
@@ -70,3 +205,115 @@ void HttpObject::setFiles(const QList<HttpFileData *> &files)
 {
     m_files = files;
 }
+
+void HttpObject::setRequest(QHttpRequest *request)
+{
+    m_request = request;
+    m_requestHeader.clear();
+    m_requestCookies.clear();
+    m_requestCookiesRead = false;
+    m_params.clear();
+    m_paramsRead = false;
+}
+
+const QVariant &HttpObject::requestHeader() const
+{
+    if (!m_requestHeader.isValid()) {
+        QVariantMap requestHeader;
+        if (m_request) {
+            foreach (const QByteArray &key, m_request->rawHeaderList()) {
+                requestHeader.insert(QString(key), QString(m_request->rawHeader(key)));
+            }
+        }
+        m_requestHeader = requestHeader;
+    }
+    return m_requestHeader;
+}
+
+const QVariantMap &HttpObject::requestCookies() const
+{
+    if (!m_requestCookiesRead) {
+        m_requestCookiesRead = true;
+        if (m_request) {
+            foreach (const QNetworkCookie &cookie, m_request->cookies()) {
+                QVariantMap c;
+                c.insert(QStringLiteral("value"), QString::fromUtf8(cookie.value()));
+                c.insert(QStringLiteral("expires"), cookie.expirationDate());
+                c.insert(QStringLiteral("domain"), cookie.domain());
+                c.insert(QStringLiteral("path"), cookie.path());
+                c.insert(QStringLiteral("secure"), cookie.isSecure());
+                c.insert(QStringLiteral("httponly"), cookie.isHttpOnly());
+                c.insert(QStringLiteral("session"), cookie.isSessionCookie());
+                m_requestCookies.insert(QString::fromUtf8(cookie.name()), c);
+            }
+        }
+    }
+    return m_requestCookies;
+}
+
+QString HttpObject::header(const QString &name) const
+{
+    if (!m_request) return QString();
+    return QString(SilkHttp::header(m_request, name.toLatin1()));
+}
+
+QString HttpObject::cookie(const QString &name) const
+{
+    if (!m_request) return QString();
+    QByteArray key = name.toUtf8();
+    foreach (const QNetworkCookie &cookie, m_request->cookies()) {
+        if (cookie.name() == key)
+            return QString::fromUtf8(cookie.value());
+    }
+    return QString();
+}
+
+static QString decodeParam(const QByteArray &source)
+{
+    QByteArray ret = source;
+    ret.replace('+', ' ');
+    return QUrl::fromPercentEncoding(ret);
+}
+
+static void parseParams(QVariantMap *params, const QByteArray &source)
+{
+    foreach (const QByteArray &pair, source.split('&')) {
+        if (pair.isEmpty()) continue;
+        int eq = pair.indexOf('=');
+        QString key = decodeParam(eq < 0 ? pair : pair.left(eq));
+        QString value = eq < 0 ? QString() : decodeParam(pair.mid(eq + 1));
+
+        QVariantMap::iterator it = params->find(key);
+        if (it == params->end()) {
+            params->insert(key, value);
+        } else {
+            QStringList values = it->type() == QVariant::StringList ? it->toStringList() : QStringList(it->toString());
+            values.append(value);
+            *it = values;
+        }
+    }
+}
+
+const QVariantMap &HttpObject::params() const
+{
+    if (!m_paramsRead) {
+        m_paramsRead = true;
+        if (m_request) {
+            parseParams(&m_params, m_request->url().query(QUrl::FullyEncoded).toLatin1());
+            if (SilkHttp::header(m_request, "Content-Type").startsWith("application/x-www-form-urlencoded"))
+                parseParams(&m_params, data().toUtf8());
+        }
+    }
+    return m_params;
+}
+
+// the last value of a name given more than once, as the body comes after the query
+QString HttpObject::param(const QString &name) const
+{
+    QVariant value = params().value(name);
+    if (value.type() == QVariant::StringList) {
+        QStringList values = value.toStringList();
+        return values.isEmpty() ? QString() : values.last();
+    }
+    return value.toString();
+}
@@ -29,10 +29,13 @@
 
 #include <silkabstracthttpobject.h>
 
+#include <QtCore/QPointer>
+#include <QtCore/QStringList>
 #include <QtCore/QTemporaryFile>
 #include <QtCore/QUrl>
 
 class QHttpFileData;
+class QHttpRequest;
 
 class HttpFileData : public QObject
 {
@@ -40,12 +43,13 @@ class HttpFileData : public QObject
     Q_PROPERTY(QString fileName READ fileName NOTIFY fileNameChanged)
     SILK_ADD_PROPERTY(const QString &, fileName, QString)
     Q_PROPERTY(QString filePath READ filePath NOTIFY filePathChanged)
-    SILK_ADD_PROPERTY(const QString &, filePath, QString)
     Q_PROPERTY(QString contentType READ contentType NOTIFY contentTypeChanged)
     SILK_ADD_PROPERTY(const QString &, contentType, QString)
 public:
     HttpFileData(QHttpFileData *data, QObject *parent = 0);
 
+    // small files are kept in memory until a path to them is asked for
+    const QString &filePath();
     Q_INVOKABLE bool save(const QString &fileName);
 
 signals:
@@ -54,7 +58,13 @@ signals:
     void contentTypeChanged(const QString &contentType);
 
 private:
+    bool spool();
+
+    QString m_filePath;
+    QByteArray m_data;
     QTemporaryFile m_file;
+    // the upload did not make it to the temporary file
+    bool m_failed;
 };
 
 class HttpObject : public QObject
@@ -75,12 +85,10 @@ class HttpObject : public QObject
     Q_PROPERTY(QString query READ query NOTIFY queryChanged)
     SILK_ADD_PROPERTY(const QString &, query, QString)
     Q_PROPERTY(QString data READ data NOTIFY dataChanged)
-    SILK_ADD_PROPERTY(const QString &, data, QString)
     Q_PROPERTY(QQmlListProperty<HttpFileData> files READ files)
     Q_PROPERTY(QVariant requestHeader READ requestHeader NOTIFY requestHeaderChanged)
-    SILK_ADD_PROPERTY(const QVariant &, requestHeader, QVariant)
     Q_PROPERTY(QVariantMap requestCookies READ requestCookies NOTIFY requestCookiesChanged)
-    SILK_ADD_PROPERTY(const QVariantMap &, requestCookies, QVariantMap)
+    Q_PROPERTY(QVariantMap params READ params NOTIFY paramsChanged)
     Q_PROPERTY(QString message READ message NOTIFY messageChanged)
     SILK_ADD_PROPERTY(const QString &, message, QString)
 
@@ -94,11 +102,39 @@ class HttpObject : public QObject
     SILK_ADD_PROPERTY(const QVariantMap &, responseCookies, QVariantMap)
     Q_PROPERTY(bool escapeHTML READ escapeHTML WRITE escapeHTML NOTIFY escapeHTMLChanged)
     SILK_ADD_PROPERTY(bool, escapeHTML, bool)
+    Q_PROPERTY(QString cacheControl READ cacheControl WRITE cacheControl NOTIFY cacheControlChanged)
+    SILK_ADD_PROPERTY(const QString &, cacheControl, QString)
+    Q_PROPERTY(int maxAge READ maxAge WRITE maxAge NOTIFY maxAgeChanged)
+    SILK_ADD_PROPERTY(int, maxAge, int)
+    Q_PROPERTY(QStringList vary READ vary WRITE vary NOTIFY varyChanged)
+    SILK_ADD_PROPERTY(const QStringList &, vary, QStringList)
+    Q_PROPERTY(bool etag READ etag WRITE etag NOTIFY etagChanged)
+    SILK_ADD_PROPERTY(bool, etag, bool)
 public:
     explicit HttpObject(QObject *parent = 0);
 
+    // back to the state of a new object, for the next request
+    void reset();
+
+    // the request body is read as the page asks for it, as a whole by data or chunk by chunk
+    const QString &data() const;
+    void setBody(QIODevice *body);
+    Q_INVOKABLE QByteArray readChunk(int maxSize = 65536);
+    Q_INVOKABLE bool atEnd() const;
+
     QQmlListProperty<HttpFileData> files();
     void setFiles(const QList<HttpFileData *> &files);
+
+    // the headers and cookies are converted for qml only when the page reads them
+    void setRequest(QHttpRequest *request);
+    const QVariant &requestHeader() const;
+    const QVariantMap &requestCookies() const;
+    Q_INVOKABLE QString header(const QString &name) const;
+    Q_INVOKABLE QString cookie(const QString &name) const;
+
+    // the query and an urlencoded form body, a name given more than once has the list of its values
+    const QVariantMap &params() const;
+    Q_INVOKABLE QString param(const QString &name) const;
 signals:
     void remoteAddressChanged(const QString &remoteAddress);
     void methodChanged(const QString &method);
@@ -111,15 +147,30 @@ signals:
     void filesChanged(const QList<HttpFileData *> &files);
     void requestHeaderChanged(const QVariant &requestHeader);
     void requestCookiesChanged(const QVariantMap &requestHeader);
+    void paramsChanged(const QVariantMap &params);
     void messageChanged(const QString &message);
     void loadingChanged(bool loading);
     void statusChanged(int status);
     void responseHeaderChanged(const QVariantMap &responseHeader);
     void responseCookiesChanged(const QVariantMap &responseHeader);
     void escapeHTMLChanged(bool escapeHTML);
+    void cacheControlChanged(const QString &cacheControl);
+    void maxAgeChanged(int maxAge);
+    void varyChanged(const QStringList &vary);
+    void etagChanged(bool etag);
+    void readyRead();
 
 private:
+    QPointer<QIODevice> m_body;
+    mutable QString m_data;
+    mutable bool m_dataRead;
     QList<HttpFileData *> m_files;
+    QPointer<QHttpRequest> m_request;
+    mutable QVariant m_requestHeader;
+    mutable QVariantMap m_requestCookies;
+    mutable bool m_requestCookiesRead;
+    mutable QVariantMap m_params;
+    mutable bool m_paramsRead;
 };
 
 #endif // HTTPOBJECT_H
@@ -26,24 +26,40 @@
 
 #include "qmlhandler.h"
 
+#include <QtCore/QAtomicInt>
+#include <QtCore/QCache>
 #include <QtCore/QCoreApplication>
+#include <QtCore/QCryptographicHash>
 #include <QtCore/QDateTime>
 #include <QtCore/QDebug>
 #include <QtCore/QDir>
+#include <QtCore/QDirIterator>
+#include <QtCore/QFileSystemWatcher>
+#include <QtCore/QHash>
+#include <QtCore/QMutex>
 #include <QtCore/QPluginLoader>
+#include <QtCore/QPointer>
+#include <QtCore/QRegularExpression>
+#include <QtCore/QSet>
+#include <QtCore/QStringList>
 #include <QtCore/QUrl>
 #include <QtNetwork/QNetworkCookie>
 #include <QtQml/qqml.h>
 #include <QtQml/QQmlEngine>
 #include <QtQml/QQmlComponent>
 #include <QtQml/QQmlContext>
+#include <QtQml/QQmlError>
 #include <QtQml/QQmlExtensionPlugin>
+#include <QtQml/QQmlIncubator>
 
 #include <qhttprequest.h>
 #include <qhttpreply.h>
 #include <qwebsocket.h>
 
 #include <silkconfig.h>
+#include <silkcompressor.h>
+#include <silkhttp.h>
+#include <silkoutputsink.h>
 #include <silkimportsinterface.h>
 
 #include "text.h"
@@ -51,56 +67,429 @@
 #include "websocketobject.h"
 #include "silk.h"
 
+// sends the output in chunks as it is rendered, instead of the whole page at the end
+class ReplySink : public SilkOutputSink
+{
+public:
+    ReplySink(QHttpReply *reply, SilkCompressor::Encoding encoding, int chunkSize, SilkByteBuffer *copy = 0)
+        : m_reply(reply)
+        , m_compressor(encoding)
+        , m_chunkSize(chunkSize)
+        , m_buffer(chunkSize)
+        , m_copy(copy)
+    {
+    }
+
+    void flush() {
+        if (m_buffer.isEmpty()) return;
+        m_reply->write(m_compressor.compress(m_buffer.data()));
+        m_buffer.clear();
+        m_buffer.reserve(m_chunkSize);
+    }
+
+    void finish() {
+        flush();
+        QByteArray data = m_compressor.finish();
+        if (!data.isEmpty())
+            m_reply->write(data);
+    }
+
+protected:
+    virtual void writeData(const char *data, int size) {
+        if (m_copy)
+            m_copy->write(data, size);
+        m_buffer.write(data, size);
+        if (m_buffer.size() >= m_chunkSize)
+            flush();
+    }
+
+private:
+    QHttpReply *m_reply;
+    SilkCompressor m_compressor;
+    int m_chunkSize;
+    SilkByteBuffer m_buffer;
+    SilkByteBuffer *m_copy;
+};
+
+// rendered output of a page which opted in to the page cache by a max age
+struct Page
+{
+    int status;
+    QVariantMap header;
+    QByteArray contentType;
+    QByteArray body;
+    QHash<int, QByteArray> encoded;
+    QByteArray hash;
+    int maxAge;
+    qint64 created;
+    qint64 expires;
+    qint64 staleUntil;
+    qint64 revalidating;
+};
+
+// the bytes a cached page holds, at least one so that an empty page is evicted too
+static int pageCost(const Page *page)
+{
+    int ret = page->body.size();
+    foreach (const QByteArray &encoded, page->encoded)
+        ret += encoded.size();
+    return qMax(1, ret);
+}
+
+// the value of a directive such as max-age=60 in Cache-Control, or -1 when it is not there
+static int cacheDirective(const QString &cacheControl, const QString &name)
+{
+    foreach (const QString &directive, cacheControl.split(QLatin1Char(','))) {
+        QString d = directive.trimmed();
+        if (d.compare(name, Qt::CaseInsensitive) == 0) return 0;
+        if (d.startsWith(name + QLatin1Char('='), Qt::CaseInsensitive)) {
+            bool ok = false;
+            int ret = d.mid(name.length() + 1).toInt(&ok);
+            return ok ? ret : -1;
+        }
+    }
+    return -1;
+}
+
+// the etag of rendered output, which differs by the encoding as the bytes sent do
+static QByteArray renderedETag(const QByteArray &hash, SilkCompressor::Encoding encoding)
+{
+    QByteArray ret = hash;
+    if (encoding != SilkCompressor::Identity)
+        ret += '-' + SilkCompressor::name(encoding);
+    return '"' + ret + '"';
+}
+
+// creates the incubating objects in slices of the event loop, so that other requests go on meanwhile
+class IncubationController : public QObject, public QQmlIncubationController
+{
+public:
+    IncubationController(int slice, QObject *parent)
+        : QObject(parent)
+        , m_slice(slice)
+        , m_timer(0)
+    {}
+
+protected:
+    virtual void incubatingObjectCountChanged(int count) {
+        if (count > 0 && m_timer == 0) {
+            m_timer = startTimer(0);
+        } else if (count == 0 && m_timer != 0) {
+            killTimer(m_timer);
+            m_timer = 0;
+        }
+    }
+
+    virtual void timerEvent(QTimerEvent *event) {
+        Q_UNUSED(event)
+        incubateFor(m_slice);
+    }
+
+private:
+    int m_slice;
+    int m_timer;
+};
+
+// watches the sources of the pages for the handlers of all workers. a page depends on the qml files
+// and the qmldir of its directory, and on what it imports by a relative path, which is followed
+// from file to file. other scripts, such as those served to browsers, are left alone
+class SourceWatcher : public QObject
+{
+    Q_OBJECT
+public:
+    static SourceWatcher *instance() {
+        static QMutex mutex;
+        static SourceWatcher *ret = 0;
+        QMutexLocker locker(&mutex);
+        if (!ret) {
+            // it lives in the main thread as long as the process
+            ret = new SourceWatcher;
+            ret->moveToThread(QCoreApplication::instance()->thread());
+        }
+        return ret;
+    }
+
+    // these may be called from any thread
+    void watchPage(const QString &filePath) {
+        QMetaObject::invokeMethod(this, "addPage", Q_ARG(QString, filePath));
+    }
+    void watchImports(const QString &directory) {
+        QMetaObject::invokeMethod(this, "addImports", Q_ARG(QString, directory));
+    }
+
+signals:
+    // a file in the directory changed, or was added or removed. the files are those which depend
+    // on it, the pages among them included
+    void changed(const QString &directory, const QStringList &files);
+
+private:
+    SourceWatcher()
+        : QObject()
+        , m_watcher(this)
+        , m_import(QStringLiteral("^\\.?import\\s+\"([^\"]+)\""))
+    {
+        connect(&m_watcher, SIGNAL(fileChanged(QString)), this, SLOT(fileChanged(QString)));
+        connect(&m_watcher, SIGNAL(directoryChanged(QString)), this, SLOT(directoryChanged(QString)));
+    }
+
+private slots:
+    void addPage(const QString &filePath) {
+        QString directory = QFileInfo(filePath).absolutePath();
+        // the components next to the page are imported implicitly
+        m_dependents[directory].insert(filePath);
+        addDirectory(directory, false);
+        addFile(filePath);
+    }
+
+    void addImports(const QString &directory) {
+        addDirectory(directory, true);
+    }
+
+    void fileChanged(const QString &filePath) {
+        // files saved by replacing them are no longer watched, and the imports may have changed
+        if (QFileInfo(filePath).exists()) {
+            if (!m_watcher.files().contains(filePath))
+                m_watcher.addPath(filePath);
+            scan(filePath);
+        }
+        emit changed(QFileInfo(filePath).absolutePath(), dependents(filePath));
+    }
+
+    void directoryChanged(const QString &directory) {
+        // a component added next to the pages is imported implicitly
+        scanDirectory(directory, m_recursive.contains(directory));
+        emit changed(directory, dependents(directory));
+    }
+
+private:
+    void addFile(const QString &filePath) {
+        if (m_files.contains(filePath)) return;
+        m_files.insert(filePath);
+        m_watcher.addPath(filePath);
+        scan(filePath);
+    }
+
+    void addDirectory(const QString &directory, bool recursive) {
+        if (m_directories.contains(directory)) return;
+        m_directories.insert(directory);
+        if (recursive)
+            m_recursive.insert(directory);
+        m_watcher.addPath(directory);
+        scanDirectory(directory, recursive);
+    }
+
+    // a file is part of its directory, and its dependents are those of what imports either
+    QStringList dependents(const QString &path) const {
+        QSet<QString> ret;
+        QStringList queue;
+        queue.append(path);
+        while (!queue.isEmpty()) {
+            QString p = queue.takeFirst();
+            if (ret.contains(p)) continue;
+            ret.insert(p);
+            if (m_files.contains(p))
+                queue.append(QFileInfo(p).absolutePath());
+            queue.append(m_dependents.value(p).toList());
+        }
+        return ret.toList();
+    }
+
+    void scanDirectory(const QString &directory, bool recursive) {
+        QDir dir(directory);
+        foreach (const QString &fileName, dir.entryList(QStringList() << QStringLiteral("*.qml") << QStringLiteral("qmldir"), QDir::Files))
+            addFile(dir.absoluteFilePath(fileName));
+        if (!recursive) return;
+        foreach (const QString &fileName, dir.entryList(QDir::Dirs | QDir::NoDotAndDotDot))
+            addDirectory(dir.absoluteFilePath(fileName), true);
+    }
+
+    // the files and directories imported by a relative path, or listed in a qmldir
+    void scan(const QString &filePath) {
+        QFile file(filePath);
+        if (!file.open(QFile::ReadOnly)) return;
+        QFileInfo fileInfo(filePath);
+        QDir dir = fileInfo.absoluteDir();
+        bool qmldir = (fileInfo.fileName() == QStringLiteral("qmldir"));
+        while (!file.atEnd()) {
+            QString line = QString::fromUtf8(file.readLine()).trimmed();
+            QString path;
+            if (qmldir) {
+                // "Type 1.0 Type.qml", "singleton Type 1.0 Type.qml" or "Name 1.0 script.js"
+                QStringList fields = line.split(QLatin1Char(' '), QString::SkipEmptyParts);
+                if (fields.count() >= 3 && !line.startsWith(QLatin1Char('#')))
+                    path = fields.last();
+            } else {
+                QRegularExpressionMatch match = m_import.match(line);
+                if (match.hasMatch())
+                    path = match.captured(1);
+            }
+            if (path.isEmpty() || path.contains(QStringLiteral(":/"))) continue;
+
+            QFileInfo target(QDir::cleanPath(dir.absoluteFilePath(path)));
+            if (target.isDir()) {
+                m_dependents[target.absoluteFilePath()].insert(filePath);
+                addDirectory(target.absoluteFilePath(), false);
+            } else if (target.isFile()) {
+                m_dependents[target.absoluteFilePath()].insert(filePath);
+                addFile(target.absoluteFilePath());
+            }
+        }
+    }
+
+    QFileSystemWatcher m_watcher;
+    QRegularExpression m_import;
+    QSet<QString> m_files;
+    QSet<QString> m_directories;
+    QSet<QString> m_recursive;
+    // the files which import a file or a directory
+    QHash<QString, QSet<QString> > m_dependents;
+};
+
+// a websocket object is set up over the next turns of the event loop, so that what its creation
+// queued runs before the properties are set, and what setting them queued runs before ready()
+struct PendingSocket
+{
+    enum State {
+        Created,
+        Opened
+    };
+
+    State state;
+    QPointer<WebSocketObject> object;
+    QPointer<QWebSocket> socket;
+    QString message;
+};
+
+// the state of a request from loading its component until the reply is closed
+struct RequestContext
+{
+    RequestContext() : request(0), reply(0), socket(0), owner(0), incubator(0), object(0), http(0), context(0), ownsComponent(false), failed(false) {}
+
+    QHttpRequest *request;
+    QHttpReply *reply;
+    QWebSocket *socket;
+    QObject *owner;
+    QString message;
+    QUrl url;
+    QPointer<QQmlComponent> component;
+    QQmlIncubator *incubator;
+    QObject *object;
+    HttpObject *http;
+    QQmlContext *context;
+    bool ownsComponent;
+    bool failed;
+};
+
+// an http object and the context which has it as http, used by one request after the other
+struct HttpContext
+{
+    HttpObject *http;
+    QQmlContext *context;
+};
+
 class QmlHandler::Private : public QObject
 {
     Q_OBJECT
 public:
     Private(QmlHandler *parent);
+    ~Private();
 
     void load(const QUrl &url, QHttpRequest *request, QHttpReply *reply, const QString &message);
     void load(const QUrl &url, QWebSocket *socket, const QString &message);
+    void warmUp(const QString &documentRoot);
 private:
-    void exec(QQmlComponent *component, QHttpRequest *request, QHttpReply *reply, const QString &message = QString());
-    void exec(QQmlComponent *component, QWebSocket *socket, const QString &message = QString());
-    void close(SilkAbstractHttpObject *http);
+    RequestContext *acquire(QObject *owner, const QUrl &url);
+    void release(RequestContext *r);
+    void fail(RequestContext *r, int status, const QString &message);
+    void reuse(const HttpContext &httpContext);
+    QQmlComponent *component(const QUrl &url, bool *owned);
+    void evict(const QString &key);
+    void exec(RequestContext *r);
+    void create(RequestContext *r);
+    void open(RequestContext *r);
+    void start(RequestContext *r, QObject *o);
+    void close(RequestContext *r);
+    SilkCompressor::Encoding writeHeader(QHttpRequest *request, QHttpReply *reply, int status, const QVariantMap &header, const QByteArray &contentType, const QStringList &vary);
+    QString pageKey(const QUrl &url, QHttpRequest *request, const QStringList &vary) const;
+    bool loadPage(const QUrl &url, QHttpRequest *request, QHttpReply *reply);
+    void registerTypes(const QDir &rootDir);
+    void startTasks(const QDir &rootDir);
 
 private slots:
     void loadingChanged(bool loading);
+    void incubated();
+    void created();
+    void socketStep();
     void statusChanged();
-    void componentDestroyed(QObject *object);
+    void requestDestroyed(QObject *object);
+    void pageDestroyed(QObject *object);
     void clearQmlCache();
-    void onError();
+    void sourceChanged(const QString &directory, const QStringList &files);
     void registerObject(const char *uri, int major, int minor);
 
 private:
+    class Incubator;
+
     QmlHandler *q;
     QQmlEngine engine;
-    QMap<QObject*, QString> component2root;
-    QMap<QObject*, QHttpRequest*> component2request;
-    QMap<QObject*, QHttpReply*> component2reply;
-    QMap<QObject*, QWebSocket*> component2socket;
-    QMap<QObject*, QString> component2message;
-    QMap<QObject*, QObject*> component2object;
-    QMap<QObject*, QHttpRequest*> object2request;
-    QMap<QObject*, QHttpReply*> object2reply;
-    QMap<QObject*, QQmlContext*> object2context;
-    QMap<QObject*, HttpObject*> object2http;
+    // cache.qml, pages keep their components and types while their files stay the same
+    bool cache;
+    bool incubate;
+    QList<Incubator *> incubatedList;
+    // the requests by their reply or socket and by their http object, and the contexts of
+    // finished requests for the next ones
+    QHash<QObject*, RequestContext*> contexts;
+    QHash<HttpObject*, RequestContext*> httpContexts;
+    QList<RequestContext*> pool;
+    // http objects with their contexts for the next requests, and those waiting for their page to go
+    QList<HttpContext> httpPool;
+    QHash<QObject*, HttpContext> recycling;
+    // the requests whose objects are created, checked for http.loading in the next turn of the event loop
+    QList<QPointer<QObject> > createdRequests;
+    QList<PendingSocket> pendingSockets;
+    // a component for each page served, which creates the page for every request and keeps its
+    // types in the component cache until its files or those of the imports change
+    QHash<QString, QQmlComponent *> keptComponents;
+    QStringList importDirectories;
+    QCache<QString, Page> pageCache;
+    QCache<QString, QStringList> pageVary;
+};
+
+// the request of a page which is being created asynchronously
+class QmlHandler::Private::Incubator : public QQmlIncubator
+{
+public:
+    Incubator(Private *d, QObject *owner)
+        : QQmlIncubator(Asynchronous)
+        , d(d)
+        , owner(owner)
+    {}
+
+    Private *d;
+    QPointer<QObject> owner;
+
+protected:
+    // the incubator may not be deleted from here, so the request goes on in the next turn of the event loop
+    virtual void statusChanged(Status status) {
+        if (status == Ready || status == Error) {
+            d->incubatedList.append(this);
+            QMetaObject::invokeMethod(d, "incubated", Qt::QueuedConnection);
+        }
+    }
 };
 
 QmlHandler::Private::Private(QmlHandler *parent)
     : QObject(parent)
     , q(parent)
+    , cache(SilkConfig::value("cache.qml", true).toBool())
+    , incubate(SilkConfig::value("incubator.enabled").toBool())
 {
+    pageCache.setMaxCost(SilkConfig::value("cache.page", 16777216).toInt());
+    pageVary.setMaxCost(1024);
+
     QQmlContext *context = engine.rootContext();
     context->setContextProperty(QStringLiteral("Silk"), new Silk(&engine));
 
-    connect(q, SIGNAL(error(int,QHttpRequest*,QHttpReply*, QString)), this, SLOT(onError()));
-    connect(q, SIGNAL(error(int,QWebSocket*, QString)), this, SLOT(onError()));
-
-    qmlRegisterType<SilkAbstractHttpObject>();
-    qmlRegisterUncreatableType<HttpFileData>("Silk.HTTP", 1, 1, "HttpFileData", QStringLiteral("readonly"));
-    qmlRegisterType<WebSocketObject>("Silk.WebSocket", 1, 0, "WebSocket");
-
     QDir appDir = QCoreApplication::applicationDirPath();
     QDir rootDir = appDir;
     QString appPath(SILK_APP_PATH);
@@ -108,9 +497,163 @@ QmlHandler::Private::Private(QmlHandler *parent)
     for (int i = 0; i < appPath.count(QLatin1Char('/')) + 1; i++) {
         rootDir.cdUp();
     }
-    QMap<QString, QObject*> plugins;
+
+    // types and tasks are process wide, the handlers of the other workers only share them
+    static QAtomicInt instances;
+    bool primary = (instances.fetchAndAddOrdered(1) == 0);
+    if (primary)
+        registerTypes(rootDir);
+
 #ifdef QT_STATIC
     engine.setImportPathList(QStringList());
+#endif
+    engine.setOfflineStoragePath(rootDir.absoluteFilePath(SilkConfig::value("storage.path").toString()));
+    engine.addImportPath(":/imports");
+    foreach (const QString &importPath, SilkConfig::value("import.path").toStringList()) {
+        engine.addImportPath(rootDir.absoluteFilePath(importPath));
+        importDirectories.append(QDir::cleanPath(rootDir.absoluteFilePath(importPath)));
+    }
+    if (cache) {
+        connect(SourceWatcher::instance(), SIGNAL(changed(QString,QStringList)), this, SLOT(sourceChanged(QString,QStringList)));
+        foreach (const QString &importDirectory, importDirectories)
+            SourceWatcher::instance()->watchImports(importDirectory);
+    }
+
+    if (primary)
+        startTasks(rootDir);
+
+    if (incubate) {
+        int slice = SilkConfig::value("incubator.slice", 5).toInt();
+        engine.setIncubationController(new IncubationController(slice > 0 ? slice : 5, this));
+    }
+}
+
+QmlHandler::Private::~Private()
+{
+    qDeleteAll(contexts);
+    qDeleteAll(pool);
+}
+
+RequestContext *QmlHandler::Private::acquire(QObject *owner, const QUrl &url)
+{
+    // a context left for the same reply would be lost
+    RequestContext *previous = contexts.value(owner);
+    if (previous)
+        release(previous);
+
+    RequestContext *ret = pool.isEmpty() ? new RequestContext : pool.takeLast();
+    ret->owner = owner;
+    ret->url = url;
+    ret->component = component(url, &ret->ownsComponent);
+    contexts.insert(owner, ret);
+    // the request goes with its reply or socket
+    connect(owner, SIGNAL(destroyed(QObject *)), this, SLOT(requestDestroyed(QObject *)), Qt::UniqueConnection);
+    return ret;
+}
+
+void QmlHandler::Private::release(RequestContext *r)
+{
+    contexts.remove(r->owner);
+    // an incubation still going on would create the page into a context used by another request
+    if (r->incubator) {
+        incubatedList.removeAll(static_cast<Incubator *>(r->incubator));
+        if (r->incubator->isReady())
+            delete r->incubator->object();
+        delete r->incubator;
+    }
+    if (r->http) {
+        httpContexts.remove(r->http);
+        disconnect(r->http, SIGNAL(loadingChanged(bool)), this, SLOT(loadingChanged(bool)));
+        HttpContext httpContext;
+        httpContext.http = r->http;
+        httpContext.context = r->context;
+        if (r->object) {
+            // the page may be running yet, its http object is reused once it is gone
+            recycling.insert(r->object, httpContext);
+            connect(r->object, SIGNAL(destroyed(QObject *)), this, SLOT(pageDestroyed(QObject *)));
+            r->object->deleteLater();
+        } else {
+            reuse(httpContext);
+        }
+    }
+    if (r->ownsComponent && r->component)
+        r->component->deleteLater();
+    // a page with errors is compiled again for the next request
+    if (!cache || r->failed)
+        QMetaObject::invokeMethod(this, "clearQmlCache", Qt::QueuedConnection);
+
+    *r = RequestContext();
+    if (pool.size() < 64)
+        pool.append(r);
+    else
+        delete r;
+}
+
+void QmlHandler::Private::fail(RequestContext *r, int status, const QString &message)
+{
+    QHttpRequest *request = r->request;
+    QHttpReply *reply = r->reply;
+    QWebSocket *socket = r->socket;
+    // the error page is loaded for the same reply, so the context goes first
+    release(r);
+    if (socket)
+        emit q->error(status, socket, message);
+    else
+        emit q->error(status, request, reply, message);
+}
+
+void QmlHandler::Private::reuse(const HttpContext &httpContext)
+{
+    if (httpPool.size() < 64) {
+        httpContext.http->reset();
+        httpPool.append(httpContext);
+    } else {
+        httpContext.context->deleteLater();
+        httpContext.http->deleteLater();
+    }
+}
+
+void QmlHandler::Private::pageDestroyed(QObject *object)
+{
+    if (recycling.contains(object))
+        reuse(recycling.take(object));
+}
+
+// the component of a page is shared by its requests while the cache is on
+QQmlComponent *QmlHandler::Private::component(const QUrl &url, bool *owned)
+{
+    *owned = !cache;
+    if (!cache)
+        return new QQmlComponent(&engine, url, this);
+
+    QString key = url.toString();
+    QQmlComponent *ret = keptComponents.value(key);
+    if (!ret) {
+        ret = new QQmlComponent(&engine, url, this);
+        keptComponents.insert(key, ret);
+        if (url.isLocalFile())
+            SourceWatcher::instance()->watchPage(QFileInfo(url.toLocalFile()).absoluteFilePath());
+    }
+    return ret;
+}
+
+// the requests which use the component yet keep it until they are done
+void QmlHandler::Private::evict(const QString &key)
+{
+    QQmlComponent *component = keptComponents.take(key);
+    if (component)
+        component->deleteLater();
+}
+
+void QmlHandler::Private::registerTypes(const QDir &rootDir)
+{
+    qmlRegisterType<SilkAbstractHttpObject>();
+    qmlRegisterUncreatableType<HttpFileData>("Silk.HTTP", 1, 1, "HttpFileData", QStringLiteral("readonly"));
+    qmlRegisterType<WebSocketObject>("Silk.WebSocket", 1, 0, "WebSocket");
+
+    QMap<QString, QObject*> plugins;
+#ifdef QT_STATIC
+    Q_UNUSED(rootDir)
     QHash<QString, QString> name2uri;
     name2uri.insert(QStringLiteral("QtQmlModelsPlugin"), QStringLiteral("QtQml.Models"));
     foreach (QObject *object, QPluginLoader::staticInstances()) {
@@ -166,13 +709,10 @@ QmlHandler::Private::Private(QmlHandler *parent)
     foreach (QObject *plugin, plugins.values()) {
         qobject_cast<SilkImportsInterface *>(plugin)->silkRegisterObject();
     }
+}
 
-    engine.setOfflineStoragePath(rootDir.absoluteFilePath(SilkConfig::value("storage.path").toString()));
-    engine.addImportPath(":/imports");
-    foreach (const QString &importPath, SilkConfig::value("import.path").toStringList()) {
-        engine.addImportPath(rootDir.absoluteFilePath(importPath));
-    }
-
+void QmlHandler::Private::startTasks(const QDir &rootDir)
+{
     QVariantList tasks = SilkConfig::value("silk.tasks").toList();
     foreach (const QVariant &task, tasks) {
         QUrl url;
@@ -207,245 +747,386 @@ void QmlHandler::Private::registerObject(const char *uri, int major, int minor)
 
 void QmlHandler::Private::load(const QUrl &url, QHttpRequest *request, QHttpReply *reply, const QString &message)
 {
-    QQmlComponent *component = new QQmlComponent(&engine, url, reply);
-    connect(component, SIGNAL(destroyed(QObject *)), this, SLOT(componentDestroyed(QObject *)), Qt::QueuedConnection);
-    exec(component, request, reply, message);
+    if (message.isEmpty() && loadPage(url, request, reply)) return;
+
+    RequestContext *r = acquire(reply, url);
+    r->request = request;
+    r->reply = reply;
+    r->message = message;
+    exec(r);
 }
 
-void QmlHandler::Private::exec(QQmlComponent *component, QHttpRequest *request, QHttpReply *reply, const QString &message)
+void QmlHandler::Private::exec(RequestContext *r)
 {
+    QQmlComponent *component = r->component;
     switch (component->status()) {
     case QQmlComponent::Null:
         // TODO: any check?
         break;
     case QQmlComponent::Error:
         qDebug() << Q_FUNC_INFO << __LINE__ << component->errorString();
-        emit q->error(500, request, reply, component->errorString());
+        r->failed = true;
+        if (!r->ownsComponent)
+            evict(r->url.toString());
+        fail(r, 500, component->errorString());
         break;
     case QQmlComponent::Loading:
-        component2request.insert(component, request);
-        component2reply.insert(component, reply);
-        component2message.insert(component, message);
         connect(component, SIGNAL(statusChanged(QQmlComponent::Status)), this, SLOT(statusChanged()), Qt::UniqueConnection);
         break;
-    case QQmlComponent::Ready: {
-        HttpObject *http = new HttpObject(component);
-        http->remoteAddress(request->remoteAddress());
-        http->method(QString::fromLatin1(request->method()));
-        QUrl url(request->url());
-        QString query(url.query());
-        url.setQuery(QString());
-        http->scheme(url.scheme());
-        http->host(url.host());
-        http->port(url.port());
-        http->path(url.path());
-        http->query(query);
-        http->data(QString(request->readAll()));
-        QList<HttpFileData *> files;
-        foreach (QHttpFileData *file, request->files()) {
-            files.append(new HttpFileData(file, http));
-        }
-        http->setFiles(files);
-
-        QVariantMap requestHeader;
-        foreach (const QByteArray &key, request->rawHeaderList()) {
-            requestHeader.insert(QString(key), QString(request->rawHeader(key)));
-        }
-        http->requestHeader(requestHeader);
-
-        QVariantMap cookies;
-        foreach (const QNetworkCookie &cookie, request->cookies()) {
-            QVariantMap c;
-            c.insert(QStringLiteral("value"), QString::fromUtf8(cookie.value()));
-            c.insert(QStringLiteral("expires"), cookie.expirationDate());
-            c.insert(QStringLiteral("domain"), cookie.domain());
-            c.insert(QStringLiteral("path"), cookie.path());
-            c.insert(QStringLiteral("secure"), cookie.isSecure());
-            c.insert(QStringLiteral("httponly"), cookie.isHttpOnly());
-            c.insert(QStringLiteral("session"), cookie.isSessionCookie());
-            cookies.insert(QString::fromUtf8(cookie.name()), c);
-        }
-        http->requestCookies(cookies);
+    case QQmlComponent::Ready:
+        if (r->socket)
+            open(r);
+        else
+            create(r);
+        break;
+    }
+}
 
-        if (!message.isEmpty()) http->message(message);
+void QmlHandler::Private::create(RequestContext *r)
+{
+    QHttpRequest *request = r->request;
+    HttpContext httpContext;
+    if (httpPool.isEmpty()) {
+        httpContext.http = new HttpObject(this);
+        httpContext.context = new QQmlContext(&engine, this);
+        httpContext.context->setContextProperty(QStringLiteral("http"), httpContext.http);
+    } else {
+        httpContext = httpPool.takeLast();
+    }
+    HttpObject *http = httpContext.http;
+    r->http = http;
+    r->context = httpContext.context;
+    httpContexts.insert(http, r);
 
-        QQmlContext *context = new QQmlContext(&engine, this);
-        context->setContextProperty(QStringLiteral("http"), http);
+    http->remoteAddress(request->remoteAddress());
+    http->method(QString::fromLatin1(request->method()));
+    QUrl url(request->url());
+    QString query(url.query());
+    url.setQuery(QString());
+    http->scheme(url.scheme());
+    http->host(url.host());
+    http->port(url.port());
+    http->path(url.path());
+    http->query(query);
+    http->setBody(request);
+    QList<HttpFileData *> files;
+    foreach (QHttpFileData *file, request->files()) {
+        files.append(new HttpFileData(file, http));
+    }
+    http->setFiles(files);
+    http->setRequest(request);
 
-        QObject *o = component->create(context);
-        o->setParent(http);
+    if (!r->message.isEmpty()) http->message(r->message);
 
-        SilkAbstractHttpObject *object = qobject_cast<SilkAbstractHttpObject*>(o);
-        if (!object) {
-            emit q->error(403, request, reply, request->url().toString());
-            return;
-        }
+    if (incubate) {
+        r->incubator = new Incubator(this, r->owner);
+        r->component->create(*r->incubator, r->context);
+    } else {
+        start(r, r->component->create(r->context));
+    }
+}
 
-        if (object->property("contentType").isValid()) {
-            component2object.insert(component, object);
-            object2request.insert(object, request);
-            object2reply.insert(object, reply);
-            object2http.insert(object, http);
-            object2context.insert(object, context);
-            QCoreApplication::processEvents();
-            if (!http->loading()) {
-                close(object);
-            } else {
-                connect(http, SIGNAL(loadingChanged(bool)), this, SLOT(loadingChanged(bool)));
-            }
-        } else {
-            emit q->error(403, request, reply, request->url().toString());
-        }
+void QmlHandler::Private::start(RequestContext *r, QObject *o)
+{
+    if (!o) {
+        QString errorString = r->component ? r->component->errorString() : QString();
+        qDebug() << Q_FUNC_INFO << __LINE__ << errorString;
+        r->failed = true;
+        fail(r, 500, errorString);
+        return;
+    }
+    o->setParent(r->http);
+    r->object = o;
 
+    SilkAbstractHttpObject *object = qobject_cast<SilkAbstractHttpObject*>(o);
+    if (!object) {
+        fail(r, 403, r->request->url().toString());
+        return;
+    }
 
-        break; }
+    if (object->property("contentType").isValid()) {
+        createdRequests.append(r->owner);
+        QMetaObject::invokeMethod(this, "created", Qt::QueuedConnection);
+    } else {
+        fail(r, 403, r->request->url().toString());
     }
 }
 
-void QmlHandler::Private::close(SilkAbstractHttpObject *object)
+void QmlHandler::Private::close(RequestContext *r)
 {
-    if (object2request.contains(object) && object2reply.contains(object) && object2context.contains(object) && object2http.contains(object)) {
-        QHttpRequest *request = object2request.take(object);
-        QHttpReply *reply = object2reply.take(object);
-        QQmlContext *context = object2context.take(object);
-        HttpObject *http = object2http.take(object);
-
-        QString out = object->out();
+    QHttpRequest *request = r->request;
+    QHttpReply *reply = r->reply;
+    HttpObject *http = r->http;
+    SilkAbstractHttpObject *object = qobject_cast<SilkAbstractHttpObject *>(r->object);
 
+    QVariantMap header = http->responseHeader();
+    if (!http->cacheControl().isEmpty() && !header.contains(QStringLiteral("Cache-Control")))
+        header.insert(QStringLiteral("Cache-Control"), http->cacheControl());
+    QByteArray contentType;
+    if (object->property("contentType").isValid())
+        contentType = object->property("contentType").toByteArray();
+    SilkCompressor::Encoding encoding = writeHeader(request, reply, http->status(), header, contentType, http->vary());
 
-        reply->setStatus(http->status());
-        QVariantMap header = http->responseHeader();
-        foreach (const QString &key, header.keys()) {
-            QString value = header.value(key).toString();
-            reply->setRawHeader(key.toUtf8(), value.toUtf8());
-        }
-
-        QList<QNetworkCookie> cookies;
-        foreach (const QString &name, http->responseCookies().keys()) {
-            QVariantMap c = http->responseCookies().value(name).toMap();
-            QNetworkCookie cookie;
-            cookie.setName(name.toUtf8());
-            if (c.contains("value")) cookie.setValue(c.value("value").toString().toUtf8());
-            if (c.contains("expires")) cookie.setExpirationDate(c.value("expires").toDateTime());
-            if (c.contains("domain")) cookie.setDomain(c.value("domain").toString());
-            if (c.contains("path")) cookie.setPath(c.value("path").toString());
-            if (c.contains("httponly")) cookie.setHttpOnly(c.value("httponly").toBool());
-            if (c.contains("secure")) cookie.setSecure(c.value("secure").toBool());
-            cookies.append(cookie);
-        }
-        reply->setCookies(cookies);
+    QList<QNetworkCookie> cookies;
+    foreach (const QString &name, http->responseCookies().keys()) {
+        QVariantMap c = http->responseCookies().value(name).toMap();
+        QNetworkCookie cookie;
+        cookie.setName(name.toUtf8());
+        if (c.contains("value")) cookie.setValue(c.value("value").toString().toUtf8());
+        if (c.contains("expires")) cookie.setExpirationDate(c.value("expires").toDateTime());
+        if (c.contains("domain")) cookie.setDomain(c.value("domain").toString());
+        if (c.contains("path")) cookie.setPath(c.value("path").toString());
+        if (c.contains("httponly")) cookie.setHttpOnly(c.value("httponly").toBool());
+        if (c.contains("secure")) cookie.setSecure(c.value("secure").toBool());
+        cookies.append(cookie);
+    }
+    reply->setCookies(cookies);
 
-        if (object->property("contentType").isValid()) {
-            reply->setRawHeader("Content-Type", object->property("contentType").toByteArray());
-        }
+    QUrl url = r->url;
+    int maxAge = http->maxAge() > 0 ? http->maxAge() : cacheDirective(http->cacheControl(), QStringLiteral("max-age"));
+    bool cacheable = request->method() == "GET" && http->message().isEmpty() && http->status() == 200 && cookies.isEmpty()
+            && maxAge > 0 && pageCache.maxCost() > 0
+            && cacheDirective(http->cacheControl(), QStringLiteral("no-store")) < 0
+            && cacheDirective(http->cacheControl(), QStringLiteral("private")) < 0;
 
+    // the other methods end with the headers, the page is not rendered for them. HEAD renders it
+    // only for its etag, which has to be the same as that of GET
+    static const int chunkSize = SilkConfig::value("stream.chunk", 262144).toInt();
+    SilkByteBuffer body;
+    QByteArray hash;
+    bool notModified = false;
+    bool head = (request->method() == "HEAD");
+    bool etag = http->etag() && (request->method() == "GET" || head) && http->status() == 200 && !header.contains(QStringLiteral("ETag"));
+    if (request->method() == "GET" || request->method() == "POST" || (head && etag)) {
         QVariant prolog = object->property("prolog");
-        if (prolog.isValid())
-            reply->write(prolog.toByteArray());
-
-//        qDebug() << out;
-        if (request->method() == "GET" || request->method() == "POST") {
-            reply->write(out.toUtf8());
+        if (etag) {
+            // the etag goes before the body, so the page is rendered as a whole first
+            SilkByteBuffer rendered;
+            if (prolog.isValid())
+                rendered.write(prolog.toByteArray());
+            object->out(rendered);
+            hash = QCryptographicHash::hash(rendered.data(), QCryptographicHash::Md5).toHex();
+            QByteArray etag = renderedETag(hash, encoding);
+            reply->setRawHeader("ETag", etag);
+            notModified = SilkHttp::matchETag(SilkHttp::header(request, "If-None-Match"), etag);
+            if (notModified) {
+                reply->setStatus(304);
+            } else if (!head) {
+                ReplySink sink(reply, encoding, chunkSize, cacheable ? &body : 0);
+                sink.write(rendered.data());
+                sink.finish();
+            }
+        } else {
+            ReplySink sink(reply, encoding, chunkSize, cacheable ? &body : 0);
+            if (prolog.isValid())
+                sink.write(prolog.toByteArray());
+            object->out(sink);
+            sink.finish();
         }
-        reply->close();
-        context->deleteLater();
-        http->deleteLater();
     }
+    reply->close();
+
+    // a page not sent again has no body to cache
+    if (cacheable && !notModified) {
+        qint64 now = QDateTime::currentMSecsSinceEpoch();
+        int staleWhileRevalidate = cacheDirective(http->cacheControl(), QStringLiteral("stale-while-revalidate"));
+        Page *page = new Page;
+        page->status = http->status();
+        page->header = header;
+        page->contentType = contentType;
+        page->body = body.data();
+        page->hash = hash;
+        page->maxAge = maxAge;
+        page->created = now;
+        page->expires = now + maxAge * 1000;
+        page->staleUntil = page->expires + qMax(staleWhileRevalidate, 0) * 1000;
+        page->revalidating = 0;
+        pageVary.insert(url.toString() + QLatin1Char('?') + request->url().query(), new QStringList(http->vary()));
+        pageCache.insert(pageKey(url, request, http->vary()), page, pageCost(page));
+    } else if (request->method() == "GET" && !notModified) {
+        pageCache.remove(pageKey(url, request, http->vary()));
+    }
+    release(r);
 }
 
-void QmlHandler::Private::loadingChanged(bool loading)
+SilkCompressor::Encoding QmlHandler::Private::writeHeader(QHttpRequest *request, QHttpReply *reply, int status, const QVariantMap &header, const QByteArray &contentType, const QStringList &vary)
 {
-    if (!loading) {
-        HttpObject *http = qobject_cast<HttpObject *>(sender());
-        close(qobject_cast<SilkAbstractHttpObject *>(http->children().first()));
+    reply->setStatus(status);
+    foreach (const QString &key, header.keys()) {
+        QString value = header.value(key).toString();
+        reply->setRawHeader(key.toUtf8(), value.toUtf8());
+    }
+
+    QByteArray type("text/html");
+    if (!contentType.isEmpty()) {
+        type = contentType;
+        reply->setRawHeader("Content-Type", contentType);
+    }
+
+    // caches have to tell the page apart by the headers and cookies in http.vary, as the page
+    // cache does, and by Accept-Encoding when it is compressed
+    QStringList varyHeader;
+    foreach (const QString &name, header.value(QStringLiteral("Vary")).toString().split(QLatin1Char(','), QString::SkipEmptyParts))
+        varyHeader.append(name.trimmed());
+    foreach (const QString &name, vary) {
+        QString field = name.startsWith(QStringLiteral("Cookie:"), Qt::CaseInsensitive) ? QStringLiteral("Cookie") : name;
+        if (!varyHeader.contains(field, Qt::CaseInsensitive))
+            varyHeader.append(field);
+    }
+
+    // an encoding set by the page itself is left as is
+    SilkCompressor::Encoding encoding = SilkCompressor::Identity;
+    bool compressible = !header.contains(QStringLiteral("Content-Encoding")) && SilkCompressor::isCompressible(type);
+    if (compressible && !varyHeader.contains(QStringLiteral("Accept-Encoding"), Qt::CaseInsensitive))
+        varyHeader.append(QStringLiteral("Accept-Encoding"));
+    if (!varyHeader.isEmpty())
+        reply->setRawHeader("Vary", varyHeader.join(QStringLiteral(", ")).toUtf8());
+
+    if (compressible) {
+        encoding = SilkCompressor::negotiate(SilkHttp::header(request, "Accept-Encoding"), type);
+        if (encoding != SilkCompressor::Identity)
+            reply->setRawHeader("Content-Encoding", SilkCompressor::name(encoding));
     }
+    return encoding;
 }
 
-void QmlHandler::Private::statusChanged()
+// path and query of the page, and the values of the request headers and cookies it varies on
+QString QmlHandler::Private::pageKey(const QUrl &url, QHttpRequest *request, const QStringList &vary) const
 {
-    QQmlComponent *component = qobject_cast<QQmlComponent *>(sender());
-    if (component2request.contains(component) && component2reply.contains(component)) {
-        exec(component, component2request.take(component), component2reply.take(component), component2message.take(component));
-    } else if (component2socket.contains(component)) {
-        exec(component, component2socket.take(component), component2message.take(component));
+    QString ret = url.toString() + QLatin1Char('?') + request->url().query();
+    foreach (const QString &name, vary) {
+        ret.append(QLatin1Char('\n'));
+        // the same header is named in any case
+        ret.append(name.toLower());
+        ret.append(QLatin1Char('='));
+        if (name.startsWith(QStringLiteral("Cookie:"), Qt::CaseInsensitive)) {
+            QByteArray cookieName = name.mid(7).trimmed().toUtf8();
+            foreach (const QNetworkCookie &cookie, request->cookies()) {
+                if (cookie.name() == cookieName) {
+                    ret.append(QString::fromUtf8(cookie.value()));
+                    break;
+                }
+            }
+        } else {
+            ret.append(QString::fromUtf8(SilkHttp::header(request, name.toUtf8())));
+        }
     }
+    return ret;
 }
 
-void QmlHandler::Private::componentDestroyed(QObject *object)
+// answers from the page cache without the engine, or returns false when the page has to be rendered
+bool QmlHandler::Private::loadPage(const QUrl &url, QHttpRequest *request, QHttpReply *reply)
 {
-    static bool cache = SilkConfig::value("cache.qml").toBool();
+    if (pageCache.isEmpty()) return false;
+    bool head = (request->method() == "HEAD");
+    if (!head && request->method() != "GET") return false;
 
-    if (component2request.contains(object)) {
-        component2request.take(object);
-    }
-    if (component2reply.contains(object)) {
-        component2reply.take(object);
-    }
-    if (component2socket.contains(object)) {
-        component2socket.take(object);
-    }
-    if (component2message.contains(object)) {
-        component2message.take(object);
+    QStringList *vary = pageVary.object(url.toString() + QLatin1Char('?') + request->url().query());
+    if (!vary) return false;
+    QString key = pageKey(url, request, *vary);
+    Page *page = pageCache.object(key);
+    if (!page) return false;
+
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    if (now >= page->expires) {
+        if (now >= page->staleUntil) {
+            pageCache.remove(key);
+            return false;
+        }
+        // one request renders the page again while the others get the stale one, unless it seems to have failed
+        if (page->revalidating == 0 || now - page->revalidating > page->maxAge * 1000) {
+            page->revalidating = now;
+            return false;
+        }
     }
-    if (component2object.contains(object)) {
-        QObject *o = component2object.take(object);
-        object2request.take(o);
-        object2reply.take(o);
-        if (object2context.contains(o)) {
-            object2context.take(o)->deleteLater();
+
+    SilkCompressor::Encoding encoding = writeHeader(request, reply, page->status, page->header, page->contentType, *vary);
+    reply->setRawHeader("Age", QByteArray::number((now - page->created) / 1000));
+    if (!page->hash.isEmpty()) {
+        QByteArray etag = renderedETag(page->hash, encoding);
+        reply->setRawHeader("ETag", etag);
+        if (SilkHttp::matchETag(SilkHttp::header(request, "If-None-Match"), etag)) {
+            reply->setStatus(304);
+            head = true;
         }
-        if (object2http.contains(o)) {
-            object2http.take(o)->deleteLater();
+    }
+    if (!head) {
+        if (encoding == SilkCompressor::Identity) {
+            reply->write(page->body);
+        } else {
+            if (page->encoded.contains(encoding)) {
+                reply->write(page->encoded.value(encoding));
+            } else {
+                QByteArray encoded = SilkCompressor::compress(page->body, encoding);
+                reply->write(encoded);
+                // the page goes in again for its new cost, which may evict it at once
+                page = pageCache.take(key);
+                page->encoded.insert(encoding, encoded);
+                pageCache.insert(key, page, pageCost(page));
+            }
         }
     }
-    if (!cache)
-        clearQmlCache();
+    reply->close();
+    return true;
 }
 
-void QmlHandler::Private::clearQmlCache()
+void QmlHandler::Private::loadingChanged(bool loading)
 {
-    engine.trimComponentCache();
+    if (!loading) {
+        RequestContext *r = httpContexts.value(qobject_cast<HttpObject *>(sender()));
+        if (r && r->object)
+            close(r);
+    }
 }
 
-void QmlHandler::Private::onError()
+void QmlHandler::Private::incubated()
 {
-    engine.clearComponentCache();
+    while (!incubatedList.isEmpty()) {
+        Incubator *incubator = incubatedList.takeFirst();
+        QObject *o = incubator->isReady() ? incubator->object() : 0;
+        // the reply may have gone while the page was being created
+        RequestContext *r = incubator->owner ? contexts.value(incubator->owner) : 0;
+        if (r)
+            r->incubator = 0;
+        if (!r) {
+            delete o;
+        } else if (!o) {
+            QStringList errors;
+            foreach (const QQmlError &error, incubator->errors())
+                errors.append(error.toString());
+            qDebug() << Q_FUNC_INFO << __LINE__ << errors;
+            r->failed = true;
+            fail(r, 500, errors.join(QStringLiteral("\n")));
+        } else {
+            start(r, o);
+        }
+        delete incubator;
+    }
 }
 
-void QmlHandler::Private::load(const QUrl &url, QWebSocket *socket, const QString &message)
+void QmlHandler::Private::created()
 {
-    QQmlComponent *component = new QQmlComponent(&engine, url, socket);
-    connect(component, SIGNAL(destroyed(QObject *)), this, SLOT(componentDestroyed(QObject *)), Qt::QueuedConnection);
-    exec(component, socket, message);
+    QPointer<QObject> owner = createdRequests.takeFirst();
+    if (!owner) return;
+    RequestContext *r = contexts.value(owner);
+    if (!r || !r->object) return;
+
+    if (!r->http->loading()) {
+        close(r);
+    } else {
+        connect(r->http, SIGNAL(loadingChanged(bool)), this, SLOT(loadingChanged(bool)));
+    }
 }
 
-void QmlHandler::Private::exec(QQmlComponent *component, QWebSocket *socket, const QString &message)
+void QmlHandler::Private::socketStep()
 {
-    static bool cache = SilkConfig::value("cache.qml").toBool();
-    switch (component->status()) {
-    case QQmlComponent::Null:
-        // TODO: any check?
-        break;
-    case QQmlComponent::Error:
-        qDebug() << Q_FUNC_INFO << __LINE__ << component->errorString();
-        emit q->error(500, socket, component->errorString());
-        break;
-    case QQmlComponent::Loading:
-        component2socket.insert(component, socket);
-        component2message.insert(component, message);
-        connect(component, SIGNAL(statusChanged(QQmlComponent::Status)), this, SLOT(statusChanged()), Qt::UniqueConnection);
-        break;
-    case QQmlComponent::Ready: {
-        WebSocketObject *object = qobject_cast<WebSocketObject*>(component->create());
-        if (!object) {
-            emit q->error(403, socket, socket->url().toString());
-            return;
-        }
-        if (!cache)
-            connect(object, SIGNAL(destroyed()), this, SLOT(clearQmlCache()), Qt::QueuedConnection);
+    PendingSocket pending = pendingSockets.takeFirst();
+    if (!pending.object || !pending.socket) return;
 
-        object->setWebSocket(socket);
-        QCoreApplication::processEvents();
+    WebSocketObject *object = pending.object;
+    switch (pending.state) {
+    case PendingSocket::Created: {
+        QWebSocket *socket = pending.socket;
         object->remoteAddress(socket->remoteAddress());
         QUrl url(socket->url());
         QString query(url.query());
@@ -476,15 +1157,124 @@ void QmlHandler::Private::exec(QQmlComponent *component, QWebSocket *socket, con
         }
         object->requestCookies(cookies);
 
-        if (!message.isEmpty()) object->message(message);
-        QCoreApplication::processEvents();
-        QMetaObject::invokeMethod(object, "ready");
+        if (!pending.message.isEmpty()) object->message(pending.message);
 
-        component2object.insert(component, object);
+        pending.state = PendingSocket::Opened;
+        pendingSockets.append(pending);
+        QMetaObject::invokeMethod(this, "socketStep", Qt::QueuedConnection);
         break; }
+    case PendingSocket::Opened:
+        QMetaObject::invokeMethod(object, "ready");
+        break;
+    }
+}
+
+void QmlHandler::Private::statusChanged()
+{
+    // the requests waiting for the component, which have no http object yet
+    QList<RequestContext *> waiting;
+    foreach (RequestContext *r, contexts) {
+        if (r->component.data() == sender() && !r->http && !r->failed)
+            waiting.append(r);
+    }
+    foreach (RequestContext *r, waiting)
+        exec(r);
+}
+
+void QmlHandler::Private::requestDestroyed(QObject *object)
+{
+    RequestContext *r = contexts.value(object);
+    if (r)
+        release(r);
+}
+
+void QmlHandler::Private::clearQmlCache()
+{
+    engine.trimComponentCache();
+}
+
+void QmlHandler::Private::load(const QUrl &url, QWebSocket *socket, const QString &message)
+{
+    RequestContext *r = acquire(socket, url);
+    r->socket = socket;
+    r->message = message;
+    exec(r);
+}
+
+void QmlHandler::Private::warmUp(const QString &documentRoot)
+{
+    if (!cache) return;
+
+    bool owned = false;
+    QDirIterator it(documentRoot, QStringList() << QStringLiteral("*.qml"), QDir::Files, QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        QFileInfo fileInfo(it.next());
+        // only the pages which can be requested, the components they use are compiled with them
+        if (fileInfo.fileName().at(0).isUpper()) continue;
+        QUrl url;
+        if (fileInfo.filePath().startsWith(QLatin1Char(':'))) {
+            url = QUrl(QStringLiteral("qrc") + fileInfo.filePath());
+        } else {
+            QFile::Permissions permissions = fileInfo.permissions();
+            if (!(permissions & QFile::ReadOther) || !(permissions & QFile::ExeOther)) continue;
+            url = QUrl::fromLocalFile(fileInfo.absoluteFilePath());
+        }
+
+        QQmlComponent *component = this->component(url, &owned);
+        if (component->isError()) {
+            qDebug() << Q_FUNC_INFO << __LINE__ << component->errorString();
+            evict(url.toString());
+        }
     }
 }
 
+// a change affects the pages which depend on it as the source watcher found, and all pages when
+// it is part of an imported module
+void QmlHandler::Private::sourceChanged(const QString &directory, const QStringList &files)
+{
+    bool imported = false;
+    foreach (const QString &importDirectory, importDirectories) {
+        if (directory == importDirectory || directory.startsWith(importDirectory + QLatin1Char('/'))) {
+            imported = true;
+            break;
+        }
+    }
+
+    QSet<QString> dependents = files.toSet();
+    foreach (const QString &key, keptComponents.keys()) {
+        QUrl url(key);
+        if (imported || (url.isLocalFile() && dependents.contains(QFileInfo(url.toLocalFile()).absoluteFilePath())))
+            evict(key);
+    }
+
+    QMetaObject::invokeMethod(this, "clearQmlCache", Qt::QueuedConnection);
+}
+
+void QmlHandler::Private::open(RequestContext *r)
+{
+    QWebSocket *socket = r->socket;
+    WebSocketObject *object = qobject_cast<WebSocketObject*>(r->component->create());
+    if (!object) {
+        fail(r, 403, socket->url().toString());
+        return;
+    }
+    if (!cache)
+        connect(object, SIGNAL(destroyed()), this, SLOT(clearQmlCache()), Qt::QueuedConnection);
+
+    object->setWebSocket(socket);
+
+    PendingSocket pending;
+    pending.state = PendingSocket::Created;
+    pending.object = object;
+    pending.socket = socket;
+    pending.message = r->message;
+    pendingSockets.append(pending);
+    QMetaObject::invokeMethod(this, "socketStep", Qt::QueuedConnection);
+
+    // the object lives on its own from here
+    release(r);
+}
+
 QmlHandler::QmlHandler(QObject *parent)
     : SilkAbstractMimeHandler(parent)
     , d(new Private(this))
@@ -517,6 +1307,11 @@ bool QmlHandler::load(const QUrl &url, QHttpRequest *request, QHttpReply *reply,
     return true;
 }
 
+void QmlHandler::warmUp(const QString &documentRoot)
+{
+    d->warmUp(documentRoot);
+}
+
 bool QmlHandler::load(const QUrl &url, QWebSocket *socket, const QString &message)
 {
     QFileInfo fileInfo;
@@ -38,6 +38,7 @@ public:
     
     virtual bool load(const QUrl &url, QHttpRequest *request, QHttpReply *reply, const QString &message = QString());
     virtual bool load(const QUrl &url, QWebSocket *socket, const QString &message = QString());
+    virtual void warmUp(const QString &documentRoot);
 
 private:
     class Private;
@@ -30,6 +30,7 @@
 #include <QtCore/QDateTime>
 #include <QtCore/QDir>
 #include <QtCore/QFile>
+#include <QtCore/QMutex>
 #include <QtCore/QUuid>
 #include <QtCore/QRegularExpression>
 #include <QtCore/QLocale>
@@ -38,7 +39,10 @@
 #include <QtQml/QQmlComponent>
 #include <QtQml/QQmlContext>
 
+#include <silkoutputsink.h>
+
 static QHash<QString, unsigned int> colorNameMap;
+static QMutex colorNameMapMutex;
 
 class Silk::Color
 {
@@ -101,6 +105,7 @@ Silk::Color::Color(const QString &str)
     , b(0)
     , a(0xFF)
 {
+    QMutexLocker locker(&colorNameMapMutex);
     if (colorNameMap.isEmpty()) {
         colorNameMap.insert(QStringLiteral("aliceblue"), ((0xFF << 24) | (240 << 16) | (248 << 8) | 255));
         colorNameMap.insert(QStringLiteral("antiquewhite"), ((0xFF << 24) | (250 << 16) | (235 << 8) | 215));
@@ -250,6 +255,7 @@ Silk::Color::Color(const QString &str)
         colorNameMap.insert(QStringLiteral("yellow"), ((0xFF << 24) | (255 << 16) | (255 << 8) | 0));
         colorNameMap.insert(QStringLiteral("yellowgreen"), ((0xFF << 24) | (154 << 16) | (205 << 8) | 50));
     }
+    locker.unlock();
 
     if (colorNameMap.contains(str)) {
         unsigned int color = colorNameMap.value(str);
@@ -410,14 +416,7 @@ bool Silk::isAvailable(const QString &uri, int major, int minor, const QString &
 
 QString Silk::escapeHTML(const QString &source) const
 {
-    QString ret = source;
-    return ret
-            .replace(QLatin1Char('&'), QStringLiteral("&amp;"))
-            .replace(QLatin1Char('<'), QStringLiteral("&lt;"))
-            .replace(QLatin1Char('>'), QStringLiteral("&gt;"))
-            .replace(QLatin1Char('"'), QStringLiteral("&quot;"))
-            .replace(QLatin1Char('\''), QStringLiteral("&#39;"))
-            ;
+    return SilkEscapeSink::escape(source, SilkEscapeSink::Attribute);
 }
 
 QString Silk::lighter(const QString &str, qreal factor) const
@@ -26,8 +26,15 @@
 
 #include "text.h"
 
+#include <silkoutputsink.h>
+
 Text::Text(QObject *parent)
     : SilkAbstractHttpObject(parent)
     , m_contentType("text/plain; charset=utf-8")
 {
 }
+
+void Text::out(SilkOutputSink &sink)
+{
+    sink.write(m_text);
+}
@@ -40,6 +40,7 @@ public:
     explicit Text(QObject *parent = 0);
     
     virtual QString out() { return text(); }
+    virtual void out(SilkOutputSink &sink);
 
 signals:
     void contentTypeChanged(const QString &contentType);
@@ -28,6 +28,7 @@
 
 #include <QtCore/QCoreApplication>
 #include <QtCore/QDebug>
+#include <QtCore/QThreadStorage>
 #include <QtCore/QUrl>
 #include <QtNetwork/QNetworkAccessManager>
 #include <QtNetwork/QNetworkRequest>
@@ -55,10 +56,10 @@ private:
     QMap<QObject *, QHttpRequest*> requestMap;
     QMap<QObject *, QHttpReply*> replyMap;
     QMap<QObject *, QNetworkReply*> replyMap2;
-    static QNetworkAccessManager *networkAccessManager;
+    static QThreadStorage<QNetworkAccessManager *> networkAccessManager;
 };
 
-QNetworkAccessManager *HttpHandler::Private::networkAccessManager = 0;
+QThreadStorage<QNetworkAccessManager *> HttpHandler::Private::networkAccessManager;
 
 HttpHandler::Private::Private(HttpHandler *parent)
     : QObject(parent)
@@ -76,20 +77,22 @@ void HttpHandler::Private::load(const QUrl &url, QHttpRequest *request, QHttpRep
         req.setRawHeader(headerName, request->rawHeader(headerName));
     }
 
-    if (!networkAccessManager) {
-        networkAccessManager = new QNetworkAccessManager;
+    // QNetworkAccessManager is not shared between threads of workers
+    if (!networkAccessManager.hasLocalData()) {
+        networkAccessManager.setLocalData(new QNetworkAccessManager);
     }
+    QNetworkAccessManager *manager = networkAccessManager.localData();
     QNetworkReply *rep;
     if (request->method() == "POST") {
-        rep = networkAccessManager->post(req, request);
+        rep = manager->post(req, request);
     } else if (request->method() == "PUT") {
-        rep = networkAccessManager->put(req, request);
+        rep = manager->put(req, request);
     } else if (request->method() == "GET") {
-        rep = networkAccessManager->get(req);
+        rep = manager->get(req);
     } else if (request->method() == "HEAD") {
-        rep = networkAccessManager->head(req);
+        rep = manager->head(req);
     } else {
-        rep = networkAccessManager->sendCustomRequest(req, request->method(), request);
+        rep = manager->sendCustomRequest(req, request->method(), request);
     }
     requestMap.insert(rep, request);
     replyMap.insert(rep, reply);
@@ -0,0 +1,154 @@
+/* Copyright (c) 2012 Silk Project.
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Silk nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL SILK BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QDebug>
+#include <QtCore/QDir>
+#include <QtCore/QDirIterator>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QMimeDatabase>
+#include <QtCore/QRegularExpression>
+#include <QtCore/QSet>
+
+#include <silkconfig.h>
+#include <silkcompressor.h>
+
+// qml and the scripts it imports run in the server and are never sent, and scripts which start
+// with .pragma or .import are written for qml only
+static bool isServerSource(const QFileInfo &fileInfo, const QByteArray &contentType, const QSet<QString> &imported)
+{
+    if (contentType == "text/x-qml" || fileInfo.fileName() == QStringLiteral("qmldir")) return true;
+    if (fileInfo.suffix() != QStringLiteral("js")) return false;
+    if (imported.contains(QDir::cleanPath(fileInfo.absoluteFilePath()))) return true;
+
+    QFile file(fileInfo.filePath());
+    if (!file.open(QFile::ReadOnly)) return false;
+    QByteArray line = file.readLine().trimmed();
+    return line.startsWith(".pragma") || line.startsWith(".import");
+}
+
+// generates foo.css.gz next to foo.css, for silk to serve without compressing it on each request
+static bool precompress(const QString &fileName, bool force, const QSet<QString> &imported)
+{
+    static QMimeDatabase mimeDatabase;
+
+    QString suffix = QString::fromLatin1(SilkCompressor::name(SilkCompressor::Gzip));
+    QFileInfo source(fileName);
+    QFileInfo target(fileName + QLatin1Char('.') + suffix);
+    if (source.fileName().startsWith(QLatin1Char('.'))) return false;
+    if (source.suffix() == suffix || source.suffix() == QString::fromLatin1(SilkCompressor::name(SilkCompressor::Brotli))) return false;
+
+    QByteArray contentType = mimeDatabase.mimeTypeForFile(source.fileName(), QMimeDatabase::MatchExtension).name().toUtf8();
+    if (!SilkCompressor::isCompressible(contentType)) return false;
+    if (isServerSource(source, contentType, imported)) return false;
+    if (!force && target.exists() && target.lastModified() >= source.lastModified()) return true;
+
+    QFile file(source.filePath());
+    if (!file.open(QFile::ReadOnly)) {
+        qWarning() << file.fileName() << file.errorString();
+        return false;
+    }
+    QByteArray data = file.readAll();
+    file.close();
+
+    QByteArray compressed = SilkCompressor::compress(data, SilkCompressor::Gzip);
+    // a variant which saves nothing is not worth serving
+    if (compressed.isEmpty() || compressed.size() >= data.size()) {
+        if (target.exists())
+            QFile::remove(target.filePath());
+        return false;
+    }
+
+    QFile out(target.filePath());
+    if (!out.open(QFile::WriteOnly | QFile::Truncate)) {
+        qWarning() << out.fileName() << out.errorString();
+        return false;
+    }
+    out.write(compressed);
+    out.close();
+    qDebug() << qPrintable(target.filePath()) << data.size() << "->" << compressed.size();
+    return true;
+}
+
+static void precompressDirectory(const QString &path, bool force)
+{
+    // the scripts the pages import by a relative path
+    QSet<QString> imported;
+    QRegularExpression import(QStringLiteral("^\\s*import\\s+\"([^\"]+\\.js)\""), QRegularExpression::MultilineOption);
+    QDirIterator qml(path, QStringList() << QStringLiteral("*.qml"), QDir::Files, QDirIterator::Subdirectories);
+    while (qml.hasNext()) {
+        QFile file(qml.next());
+        if (!file.open(QFile::ReadOnly)) continue;
+        QRegularExpressionMatchIterator matches = import.globalMatch(QString::fromUtf8(file.readAll()));
+        while (matches.hasNext())
+            imported.insert(QDir::cleanPath(qml.fileInfo().absoluteDir().absoluteFilePath(matches.next().captured(1))));
+    }
+
+    QDirIterator it(path, QDir::Files, QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        precompress(it.next(), force, imported);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    // the types to compress are those silk compresses, so read its configuration
+    app.setApplicationName(QStringLiteral("silk"));
+    SilkConfig::initialize(argc, argv);
+
+    bool force = false;
+    QStringList paths;
+    for (int i = 1; i < argc; i++) {
+        QString arg = QString::fromLocal8Bit(argv[i]);
+        if (arg == QStringLiteral("--config")) {
+            i++;
+        } else if (arg == QStringLiteral("--force")) {
+            force = true;
+        } else {
+            paths.append(arg);
+        }
+    }
+
+    if (paths.isEmpty()) {
+        qWarning("usage: silk-precompress [--force] [--config file] <document root>...");
+        return -1;
+    }
+
+    int ret = 0;
+    foreach (const QString &path, paths) {
+        QFileInfo fileInfo(path);
+        // only files on disk get siblings, the sources of resources are left as they are
+        if (fileInfo.isDir()) {
+            precompressDirectory(path, force);
+        } else {
+            qWarning() << path << "is not a directory.";
+            ret = -1;
+        }
+    }
+    return ret;
+}
@@ -0,0 +1,24 @@
+TEMPLATE = app
+TARGET = silk-precompress
+
+QT -= gui
+CONFIG += console
+
+include(../../silk.pri)
+
+DESTDIR = $$SILK_BUILD_TREE/$$SILK_TARGET_PATH/$$SILK_APP_PATH
+
+CONFIG(shared, static|shared) {
+    QMAKE_RPATHDIR += \$\$ORIGIN/../$$SILK_LIBRARY_PATH
+    include(../../silkrpath.pri)
+}
+include(../lib/lib.pri)
+
+include(../../etc/etc.pri)
+
+silk_platform_mac | silk_platform_linux {
+    target.path = $$PREFIX/$$SILK_APP_PATH
+    INSTALLS += target
+}
+
+SOURCES += main.cpp
@@ -32,7 +32,6 @@
 
 #ifdef QT_STATIC
 #include <QtCore/QtPlugin>
-    Q_IMPORT_PLUGIN(DeflatePlugin)
     Q_IMPORT_PLUGIN(QmlPlugin)
         Q_IMPORT_PLUGIN(QtQmlModelsPlugin)
         Q_IMPORT_PLUGIN(BootstrapPlugin)
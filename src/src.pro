@@ -1,4 +1,4 @@
 TEMPLATE = subdirs
 CONFIG += ordered
-SUBDIRS = lib plugins imports silk
+SUBDIRS = lib plugins imports silk precompress
 